@@ -2,6 +2,7 @@
 #include <times.hpp>
 #include <geometry.hpp>
 #include <rotator.hpp>
+#include <model.hpp>
 
 // namespace math
 // {
@@ -24,8 +25,6 @@ using forecast = math::integrator<math::vec6, std::time_t, std::time_t>;
  */
 forecast make_forecast(math::vec6 const &v, time_type tn, time_type tk, double s);
 
-using vec55 = math::vec<55>;
+using forecastext = math::integrator<variations::vector, std::time_t, std::time_t>;
 
-using forecastext = math::integrator<vec55, std::time_t, std::time_t>;
-
-forecastext make_forecast(vec55 const &v, time_type tn, time_type tk, double s);
\ No newline at end of file
+forecastext make_forecast(variations::vector const &v, time_type tn, time_type tk, double s);
\ No newline at end of file
@@ -1,15 +1,28 @@
 #pragma once
-#include <ball.hpp>
+#include <gptfixed.hpp>
 #include <maths.hpp>
+#include <variational.hpp>
 #include <times.hpp>
 #include <geometry.hpp>
 #include <rotator.hpp>
 
-using vec55 = math::vec<55>;
+/**
+ * @brief Вектор с матрицей чувствительности по начальному вектору и баллистическому коэффициенту
+ *
+ */
+using variations = math::variational<7>;
+
+/**
+ * @brief Степень разложения геопотенциала в модели движения
+ *
+ */
+std::size_t constexpr gpt_degree{36};
+
+using motion_gpt = geopotential_fixed<gpt_degree>;
 
 class motion_model
 {
-    geopotential _gpt;
+    motion_gpt _gpt;
     double _sb;
     // std::vector<geometry> const &_geometries;
     // rotator _rotator;
@@ -24,10 +37,10 @@ public:
     math::interval<double> heights{100e3, 10000e3};
 
 public:
-    motion_model(std::size_t harmonics, double sball);
+    explicit motion_model(double sball);
     // motion_model(std::size_t harmonics, double sball,
     //              std::vector<geometry> const &geometries,
     //              rotator const &rot);
     math::vec6 operator()(math::vec6 const &v, time_t t);
-    vec55 operator()(vec55 const &v, time_t t);
+    variations::vector operator()(variations::vector const &v, time_t t);
 };
\ No newline at end of file
@@ -75,7 +75,7 @@ public:
                 rv[index] = iter->v[i] - p[i];
                 for (std::size_t j{}; j < dm.rows(); ++j)
                 {
-                    dm[j][index] = p[6 + j * v.size() + i];
+                    dm[j][index] = variations::sensitivity(p, i, j);
                 }
                 ++index;
             }
@@ -94,13 +94,7 @@ private:
     }
     forecastext _make_forecastext(math::vector const &in) const
     {
-        vec55 v;
-        std::memcpy(v.data(), in.data(), sizeof(double) * 6);
-        for (auto ptr = v.data() + 6; ptr < v.data() + v.size(); ptr += in.size() + 1)
-        {
-            *ptr = 1;
-        }
-        return make_forecast(v,
+        return make_forecast(variations::initial(in.data()),
                              _begin->t,
                              (_end - 1)->t,
                              in[6]);
@@ -14,7 +14,20 @@ auto rotforce(double const v[6])
     return a;
 }
 
-auto gptforce(double const in[3], geopotential &gpt)
+/**
+ * @brief Производные ускорения от вращения ГСК по положению и по скорости
+ */
+auto diffrotforce()
+{
+    double constexpr w = egm::angv;
+    math::mat3x3 dr, dv;
+    dr[0][0] = dr[1][1] = w * w;
+    dv[0][1] = 2 * w;
+    dv[1][0] = -2 * w;
+    return std::make_pair(dr, dv);
+}
+
+auto gptforce(double const in[3], motion_gpt const &gpt)
 {
     math::vec3 out;
     gpt.diffbyxyz(in, out.data());
@@ -247,9 +260,8 @@ enum class yeartype
 
 constexpr yeartype yy = static_cast<yeartype>(1);
 
-motion_model::motion_model(std::size_t harmonics, double sball)
-    : _gpt{harmonics},
-      _sb{sball}
+motion_model::motion_model(double sball)
+    : _sb{sball}
 {
 }
 
@@ -298,53 +310,37 @@ math::vec6 motion_model::operator()(math::vec6 const &v, time_t t)
     };
 }
 
-vec55 motion_model::operator()(vec55 const &v, time_t t)
+variations::vector motion_model::operator()(variations::vector const &v, time_t t)
 {
     double h = check_height(v.data(), t);
     double st = sidereal_time(t);
     sun s{t, st};
     moon m{t, st};
-    double gptac[3], gptmx[3][3];
-    _gpt.ddiffbyxyz(v.data(), gptac, gptmx);
-    auto solac_ = s.gptforce(v.data());
-    auto lunac_ = m.gptforce(v.data());
+    gpt_values gpt;
+    _gpt.evaluate<gpt_order::hessian>(v.data(), gpt);
+    auto &gptac = gpt.du;
+    auto &gptmx = gpt.ddu;
     auto [solac, solmx] = s.diffgptforce(v.data());
     auto [lunac, lunmx] = m.diffgptforce(v.data());
     auto [atmac, atmmx] = s.diffatmforce(v.data(), h, t);
-    vec55 out;
-    constexpr std::size_t vdim{7};
-    for (std::size_t i{}; i <= vdim; ++i)
-    {
-        std::size_t index = (6 + (i - 1) * vdim) * std::size_t(i > 0);
-        // заносим производные координат
-        for (std::size_t j{}; j < 3; ++j)
-        {
-            out[index + j] = v[index + j + 3];
-        }
-        auto rotac = rotforce(v.data() + index);
-        // заносим ускорение от врашения ГСК
-        for (std::size_t j{}; j < 3; ++j)
-        {
-            out[index + j + 3] = rotac[j];
-        }
-    }
-    // заносим ускорения геопотенциала
+    auto rotac = rotforce(v.data());
+    double dv[6]{v[3], v[4], v[5]};
     for (std::size_t i{}; i < 3; ++i)
     {
-        out[3 + i] += gptac[i] + solac[i] + lunac[i] + atmac[i] * _sb;
+        dv[3 + i] = rotac[i] + gptac[i] + solac[i] + lunac[i] + atmac[i] * _sb;
     }
-    // заносим ускорения от вариаций геопотенциала
-    for (std::size_t i{}; i < vdim; ++i)
+    // производные ускорения по положению (с центробежным) и по скорости (кориолисово)
+    auto [rotmx, cormx] = diffrotforce();
+    math::mat3x3 posmx;
+    for (std::size_t j{}; j < 3; ++j)
     {
-        std::size_t index{6 + i * vdim};
-        for (std::size_t j{}; j < 3; ++j)
+        for (std::size_t k{}; k < 3; ++k)
         {
-            for (std::size_t k{}; k < 3; ++k)
-            {
-                out[index + 3 + j] += (gptmx[j][k] + solmx[j][k] + lunmx[j][k] + atmmx[j][k] * _sb) * v[index + k];
-            }
-            out[index + 3 + j] += atmac[j] * v[index + 6];
+            posmx[j][k] = gptmx[j][k] + solmx[j][k] + lunmx[j][k] + atmmx[j][k] * _sb + rotmx[j][k];
         }
     }
+    auto out = variations::derivative(v, dv, posmx, cormx);
+    // ускорение от сопротивления атмосферы линейно по баллистическому коэффициенту
+    variations::add_parameter(out, 0, atmac.data());
     return out;
 }
\ No newline at end of file
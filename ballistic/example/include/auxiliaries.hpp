@@ -0,0 +1,7 @@
+#pragma once
+
+void throw_computation_error(char const *msg, char const *file, int line);
+
+#define throw_if_not(cond, msg) \
+    if (!(cond))                \
+        throw_computation_error(msg, __FILE__, __LINE__);
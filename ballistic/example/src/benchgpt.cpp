@@ -0,0 +1,333 @@
+#include <auxiliaries.hpp>
+#include <gptfield.hpp>
+#include <gptfixed.hpp>
+#include <gptstore.hpp>
+#include <maths.hpp>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using math::sqr;
+
+namespace
+{
+	double relative_error(double const *l, double const *r, size_t n)
+	{
+		double num{}, den{};
+		for (size_t i{}; i < n; ++i)
+		{
+			num += (l[i] - r[i]) * (l[i] - r[i]);
+			den += r[i] * r[i];
+		}
+		return std::sqrt(num / den);
+	}
+
+	/**
+	 * @brief Среднее время вычисления ускорения в мкс
+	 */
+	double measure(geopotential const &gpt, size_t iterations, double const pos[3])
+	{
+		double in[3]{pos[0], pos[1], pos[2]}, out[3];
+		double sum{};
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i{}; i < iterations; ++i)
+		{
+			in[0] += 1;
+			gpt.diffbyxyz(in, out);
+			sum += out[0];
+		}
+		auto finish = std::chrono::steady_clock::now();
+		// не даём компилятору выбросить вычисления
+		if (std::isnan(sum))
+		{
+			std::cout << "nan\n";
+		}
+		return std::chrono::duration<double, std::micro>(finish - start).count() / iterations;
+	}
+}
+
+/**
+ * @brief Сравнение сферического и декартова способов вычисления геопотенциала по скорости и точности, в т.ч. над полюсом
+ *
+ */
+void bench_gpt()
+{
+	std::mt19937 gen{1};
+	std::uniform_real_distribution<double> distr{-1, 1};
+	std::cout << "geopotential: spherical vs cartesian\n";
+	std::cout << std::setw(6) << "degree" << std::setw(14) << "sph, us" << std::setw(14) << "cart, us"
+			  << std::setw(14) << "grad diff" << std::setw(14) << "hess diff" << std::setw(14) << "pole diff" << '\n';
+	for (size_t degree : {16, 36, 70, 180, 360})
+	{
+		geopotential sph{degree}, cart{degree, gpt_engine::cartesian};
+		double grad_diff{}, hess_diff{};
+		for (size_t i{}; i < 100; ++i)
+		{
+			double in[3]{distr(gen), distr(gen), distr(gen)};
+			double norm = std::sqrt(in[0] * in[0] + in[1] * in[1] + in[2] * in[2]);
+			for (auto &e : in)
+			{
+				e *= 7e6 / norm;
+			}
+			gpt_values l, r;
+			sph.evaluate<gpt_order::hessian>(in, l);
+			cart.evaluate<gpt_order::hessian>(in, r);
+			grad_diff = std::max(grad_diff, relative_error(r.du, l.du, 3));
+			hess_diff = std::max(hess_diff, relative_error(&r.ddu[0][0], &l.ddu[0][0], 9));
+		}
+		// в 1 мм от оси вращения
+		double pole[3]{1e-3, 0, 6.9e6};
+		gpt_values l, r;
+		sph.evaluate<gpt_order::gradient>(pole, l);
+		cart.evaluate<gpt_order::gradient>(pole, r);
+		throw_if_not(grad_diff < 1e-13 && hess_diff < 1e-13, "spherical and cartesian geopotentials differ");
+		throw_if_not(relative_error(r.du, l.du, 3) < 1e-13, "spherical and cartesian geopotentials differ near the pole");
+		size_t iterations = degree > 100 ? 200 : 5000;
+		double pos[3]{3e6, -4e6, 4.5e6};
+		double sph_time = measure(sph, iterations, pos);
+		double cart_time = measure(cart, iterations, pos);
+		std::cout << std::setw(6) << degree << std::setw(14) << sph_time << std::setw(14) << cart_time
+				  << std::setw(14) << grad_diff << std::setw(14) << hess_diff << std::setw(14) << relative_error(r.du, l.du, 3) << '\n';
+	}
+}
+
+/**
+ * @brief Выигрыш от уменьшения степени разложения с высотой и фактическая погрешность ускорения
+ *
+ */
+void bench_adaptive_gpt()
+{
+	constexpr double tolerance{1e-9};
+	geopotential full{360}, adaptive{360, gpt_engine::spherical, tolerance};
+	std::cout << "geopotential: full vs adaptive degree (tolerance " << tolerance << " m/s^2)\n";
+	std::cout << std::setw(10) << "height, km" << std::setw(8) << "degree" << std::setw(14) << "full, us"
+			  << std::setw(14) << "adaptive, us" << std::setw(14) << "error" << '\n';
+	for (double height : {4e5, 1e6, 2e7, 3.6e7, 1e8})
+	{
+		double r = egm::rad + height;
+		double in[3]{0.6 * r, -0.48 * r, 0.64 * r}, lout[3], rout[3];
+		full.diffbyxyz(in, lout);
+		adaptive.diffbyxyz(in, rout);
+		double error = std::sqrt(sqr(lout[0] - rout[0]) + sqr(lout[1] - rout[1]) + sqr(lout[2] - rout[2]));
+		throw_if_not(error < tolerance, "adaptive degree exceeds the tolerance");
+		in[0] -= 100;
+		double full_time = measure(full, 100, in);
+		double adaptive_time = measure(adaptive, 100, in);
+		std::cout << std::setw(10) << height * 1e-3 << std::setw(8) << adaptive.degree(r) << std::setw(14) << full_time
+				  << std::setw(14) << adaptive_time << std::setw(14) << error << '\n';
+	}
+}
+
+/**
+ * @brief Сравнение интерполяции по кэшу ускорений с вычислением по гармоникам вдоль витков орбиты
+ *
+ */
+void bench_gpt_field()
+{
+	constexpr double tolerance{1e-6};
+	constexpr size_t count{20000};
+	geopotential gpt{36};
+	auto start = std::chrono::steady_clock::now();
+	gpt_field field{gpt, egm::rad + 6e5, egm::rad + 8e5, tolerance};
+	auto built = std::chrono::steady_clock::now();
+	// круговая орбита с наклонением 98 градусов и шагом 10 с
+	std::vector<std::array<double, 3>> points(count);
+	for (size_t i{}; i < count; ++i)
+	{
+		double r = egm::rad + 7e5, u = i * 1.1e-2, l = i * -7.3e-4;
+		double x = r * std::cos(u), y = r * std::sin(u) * std::cos(1.71), z = r * std::sin(u) * std::sin(1.71);
+		points[i] = {x * std::cos(l) - y * std::sin(l), x * std::sin(l) + y * std::cos(l), z};
+	}
+	double error{}, exact[3], approx[3];
+	for (auto const &p : points)
+	{
+		field.diffbyxyz(p.data(), approx);
+	}
+	auto filled = std::chrono::steady_clock::now();
+	for (auto const &p : points)
+	{
+		gpt.diffbyxyz(p.data(), exact);
+	}
+	auto synthesized = std::chrono::steady_clock::now();
+	for (auto const &p : points)
+	{
+		field.diffbyxyz(p.data(), approx);
+	}
+	auto interpolated = std::chrono::steady_clock::now();
+	for (auto const &p : points)
+	{
+		gpt.diffbyxyz(p.data(), exact);
+		field.diffbyxyz(p.data(), approx);
+		error = std::max(error, std::sqrt(sqr(exact[0] - approx[0]) + sqr(exact[1] - approx[1]) + sqr(exact[2] - approx[2])));
+	}
+	using ms = std::chrono::duration<double, std::milli>;
+	using us = std::chrono::duration<double, std::micro>;
+	std::cout << "geopotential field cache: degree 36, 600-800 km, tolerance " << tolerance << " m/s^2\n";
+	std::cout << "calibration " << ms(built - start).count() << " ms, first pass (lazy build) " << ms(filled - built).count()
+			  << " ms, nodes " << field.size() << ", " << field.bytes() / 1024 << " KB\n";
+	std::cout << "harmonics " << us(synthesized - filled).count() / count << " us, cache " << us(interpolated - synthesized).count() / count
+			  << " us, max error " << error << '\n';
+	throw_if_not(error < tolerance, "field cache exceeds the tolerance");
+	// сетка степени 360 в слое 200 км (около 1.7 ГБ) отклоняется до вычисления узлов
+	bool rejected{};
+	try
+	{
+		gpt_field huge{geopotential{360}, egm::rad + 6e5, egm::rad + 8e5, tolerance};
+	}
+	catch (std::invalid_argument const &)
+	{
+		rejected = true;
+	}
+	throw_if_not(rejected, "field cache above the memory limit is not rejected");
+}
+
+namespace
+{
+	template <size_t N>
+	void bench_fixed_gpt()
+	{
+		geopotential dynamic{N, gpt_engine::cartesian};
+		geopotential_fixed<N> fixed;
+		double pos[3]{3e6, -4e6, 4.5e6}, lout[3], rout[3];
+		dynamic.diffbyxyz(pos, lout);
+		fixed.diffbyxyz(pos, rout);
+		double error = std::sqrt(sqr(lout[0] - rout[0]) + sqr(lout[1] - rout[1]) + sqr(lout[2] - rout[2]));
+		throw_if_not(error < 1e-12, "runtime and compile-time degree geopotentials differ");
+		constexpr size_t iterations{20000};
+		double dynamic_time = measure(dynamic, iterations, pos);
+		double in[3]{pos[0], pos[1], pos[2]}, sum{};
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i{}; i < iterations; ++i)
+		{
+			in[0] += 1;
+			fixed.diffbyxyz(in, rout);
+			sum += rout[0];
+		}
+		auto finish = std::chrono::steady_clock::now();
+		if (std::isnan(sum))
+		{
+			std::cout << "nan\n";
+		}
+		double fixed_time = std::chrono::duration<double, std::micro>(finish - start).count() / iterations;
+		std::cout << std::setw(6) << N << std::setw(14) << dynamic_time << std::setw(14) << fixed_time << std::setw(14) << error << '\n';
+	}
+}
+
+/**
+ * @brief Сравнение потенциала со степенью, заданной при выполнении и при компиляции
+ *
+ */
+void bench_fixed_gpt()
+{
+	std::cout << "geopotential: runtime vs compile-time degree (cartesian)\n";
+	std::cout << std::setw(6) << "degree" << std::setw(14) << "runtime, us" << std::setw(14) << "fixed, us" << std::setw(14) << "diff" << '\n';
+	bench_fixed_gpt<16>();
+	bench_fixed_gpt<36>();
+}
+
+/**
+ * @brief Сравнение обхода треугольника полиномов по степеням и потокового обхода по столбцам порядка m
+ *
+ */
+void bench_streaming_gpt()
+{
+	std::cout << "geopotential: degree-major triangle vs order-major streaming (cartesian)\n";
+	std::cout << std::setw(6) << "degree" << std::setw(14) << "triangle, us" << std::setw(14) << "stream, us"
+			  << std::setw(16) << "triangle, KB" << std::setw(14) << "stream, KB" << std::setw(14) << "buffers, KB"
+			  << std::setw(14) << "grad diff" << std::setw(14) << "hess diff" << '\n';
+	for (size_t degree : {70, 180, 360})
+	{
+		geopotential triangle{degree, gpt_engine::cartesian}, stream{degree, gpt_engine::streaming};
+		double grad_diff{}, hess_diff{};
+		std::mt19937 gen{2};
+		std::uniform_real_distribution<double> distr{-1, 1};
+		for (size_t i{}; i < 100; ++i)
+		{
+			double in[3]{distr(gen), distr(gen), distr(gen)};
+			double norm = std::sqrt(in[0] * in[0] + in[1] * in[1] + in[2] * in[2]);
+			for (auto &e : in)
+			{
+				e *= 6.8e6 / norm;
+			}
+			gpt_values l, r;
+			triangle.evaluate<gpt_order::hessian>(in, l);
+			stream.evaluate<gpt_order::hessian>(in, r);
+			grad_diff = std::max(grad_diff, relative_error(r.du, l.du, 3));
+			hess_diff = std::max(hess_diff, relative_error(&r.ddu[0][0], &l.ddu[0][0], 9));
+		}
+		throw_if_not(grad_diff < 1e-13 && hess_diff < 1e-13, "triangle and streaming geopotentials differ");
+		size_t iterations = degree > 100 ? 300 : 5000;
+		double pos[3]{3e6, -4e6, 4.5e6};
+		double triangle_time = measure(triangle, iterations, pos);
+		double stream_time = measure(stream, iterations, pos);
+		/**
+		 * Объём данных, проходящих через кэш за одно вычисление ускорения:
+		 * по степеням - гармоники (16 байт), множители (32 байта), запись и чтение полинома (2 * 8 байт) на гармонику;
+		 * по столбцам - множители рекурсии (16 байт) и гармоники с множителями производных (32 байта), буфер - три столбца.
+		 */
+		double dim = double(egm::harmonics_count(degree)) / 1024;
+		std::cout << std::setw(6) << degree << std::setw(14) << triangle_time << std::setw(14) << stream_time
+				  << std::setw(16) << dim * 64 << std::setw(14) << dim * 48 << std::setw(14) << 3 * (degree + 1) * 8 / 1024.
+				  << std::setw(14) << grad_diff << std::setw(14) << hess_diff << '\n';
+	}
+}
+
+/**
+ * @brief Погрешность ускорения, вносимая суммированием старших степеней в одинарной точности, для моделей egm96 и jgm3
+ *
+ * @param egmpath путь к файлу гармоник egm96
+ * @param jgmpath путь к файлу гармоник jgm3
+ */
+void bench_mixed_gpt(char const *egmpath, char const *jgmpath)
+{
+	std::cout << "geopotential: double vs mixed precision (spherical)\n";
+	std::cout << std::setw(8) << "model" << std::setw(8) << "degree" << std::setw(8) << "single" << std::setw(14) << "double, us"
+			  << std::setw(14) << "mixed, us" << std::setw(14) << "max error" << std::setw(14) << "rel error" << '\n';
+	for (auto [name, path] : {std::pair{"egm96", egmpath}, std::pair{"jgm3", jgmpath}})
+	{
+		auto model = egm::load_model(name, path);
+		size_t degree = model->degree();
+		geopotential full{model, degree};
+		for (size_t single : {16, 36, 70, 180})
+		{
+			if (single >= degree)
+			{
+				continue;
+			}
+			geopotential mixed{model, degree, gpt_engine::mixed, 0, single};
+			std::mt19937 gen{4};
+			std::uniform_real_distribution<double> distr{-1, 1}, height{3e5, 2e6};
+			double error{}, rel_error{};
+			for (size_t i{}; i < 1000; ++i)
+			{
+				double in[3]{distr(gen), distr(gen), distr(gen)};
+				double norm = std::sqrt(sqr(in[0]) + sqr(in[1]) + sqr(in[2]));
+				double r = egm::rad + height(gen);
+				for (auto &e : in)
+				{
+					e *= r / norm;
+				}
+				double lout[3], rout[3];
+				full.diffbyxyz(in, lout);
+				mixed.diffbyxyz(in, rout);
+				double diff = std::sqrt(sqr(lout[0] - rout[0]) + sqr(lout[1] - rout[1]) + sqr(lout[2] - rout[2]));
+				error = std::max(error, diff);
+				rel_error = std::max(rel_error, diff / std::sqrt(sqr(lout[0]) + sqr(lout[1]) + sqr(lout[2])));
+			}
+			size_t iterations = degree > 100 ? 300 : 3000;
+			double pos[3]{3e6, -4e6, 4.5e6};
+			double full_time = measure(full, iterations, pos);
+			double mixed_time = measure(mixed, iterations, pos);
+			std::cout << std::setw(8) << name << std::setw(8) << degree << std::setw(8) << single << std::setw(14) << full_time
+					  << std::setw(14) << mixed_time << std::setw(14) << error << std::setw(14) << rel_error << '\n';
+			throw_if_not(rel_error < 1e-11, "mixed precision error exceeds 1e-11");
+			// без AVX2 все степени суммируются в double, и время совпадает с временем двойной точности
+			throw_if_not(mixed_time < 1.5 * full_time, "mixed precision is slower than double");
+		}
+	}
+}
@@ -0,0 +1,1002 @@
+#include <auxiliaries.hpp>
+#include <ball.hpp>
+#include <chebyshev.hpp>
+#include <encke.hpp>
+#include <gptfixed.hpp>
+#include <integration.hpp>
+#include <lockstep.hpp>
+#include <maths.hpp>
+#include <statistics.hpp>
+#include <transform.hpp>
+#include <variational.hpp>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using math::sqr;
+using math::vec6;
+
+namespace
+{
+	/**
+	 * @brief Эллиптическая орбита в плоскости xy, движение начинается в перигее
+	 */
+	struct kepler_orbit
+	{
+		double a, e;
+
+		double period() const { return 2 * math::pi * std::sqrt(a * a * a / egm::mu); }
+
+		vec6 initial() const
+		{
+			double rp = a * (1 - e);
+			return vec6{rp, 0, 0, 0, std::sqrt(egm::mu * (1 + e) / rp), 0};
+		}
+
+		/**
+		 * @brief Положение на заданный момент (решение уравнения Кеплера методом Ньютона)
+		 */
+		void position(double t, double out[2]) const
+		{
+			double m = std::sqrt(egm::mu / (a * a * a)) * t;
+			double ea = m;
+			for (size_t i{}; i < 50; ++i)
+			{
+				double delta = (ea - e * std::sin(ea) - m) / (1 - e * std::cos(ea));
+				ea -= delta;
+				if (std::abs(delta) < 1e-15)
+				{
+					break;
+				}
+			}
+			out[0] = a * (std::cos(ea) - e);
+			out[1] = a * std::sqrt(1 - e * e) * std::sin(ea);
+		}
+	};
+
+	/**
+	 * @brief Правая часть задачи двух тел со счётчиком вычислений
+	 */
+	struct two_body
+	{
+		size_t &calls;
+
+		vec6 operator()(vec6 const &v, double) const
+		{
+			++calls;
+			double r = std::sqrt(sqr(v[0]) + sqr(v[1]) + sqr(v[2]));
+			double mult = -egm::mu / (r * r * r);
+			return vec6{v[3], v[4], v[5], v[0] * mult, v[1] * mult, v[2] * mult};
+		}
+	};
+
+	/**
+	 * @brief Наибольшая погрешность положения в узлах и при интерполяции между ними (Лагранж по 4 узлам и Эрмит)
+	 */
+	template <typename I>
+	void report(char const *name, I const &forecast, kepler_orbit const &orbit, double duration, size_t calls)
+	{
+		double node_error{}, lagrange_error{}, hermite_error{}, exact[2];
+		for (auto const &p : forecast._points)
+		{
+			orbit.position(p.t, exact);
+			node_error = std::max(node_error, std::sqrt(sqr(p.v[0] - exact[0]) + sqr(p.v[1] - exact[1])));
+		}
+		// интерполяция Лагранжа есть только у интегратора Адамса с постоянным шагом: на неравномерной сетке
+		// адаптивного шага её погрешность достигает километров, и там используется только интерполяция Эрмита
+		constexpr bool lagrange = requires { forecast.template point<4>(0.); };
+		constexpr size_t samples{5000};
+		std::vector<double> times(samples + 1);
+		for (size_t i{}; i <= samples; ++i)
+		{
+			times[i] = duration * i / samples;
+		}
+		auto points = forecast.points(times);
+		for (size_t i{}; i <= samples; ++i)
+		{
+			orbit.position(times[i], exact);
+			if constexpr (lagrange)
+			{
+				auto v = forecast.template point<4>(times[i]);
+				lagrange_error = std::max(lagrange_error, std::sqrt(sqr(v[0] - exact[0]) + sqr(v[1] - exact[1])));
+			}
+			hermite_error = std::max(hermite_error, std::sqrt(sqr(points[i][0] - exact[0]) + sqr(points[i][1] - exact[1])));
+		}
+		std::cout << std::setw(20) << name << std::setw(10) << forecast._points.size() << std::setw(10) << calls
+				  << std::setw(14) << node_error << std::setw(14);
+		if (lagrange)
+		{
+			std::cout << lagrange_error;
+		}
+		else
+		{
+			std::cout << "-";
+		}
+		std::cout << std::setw(14) << hermite_error << '\n';
+		// между узлами погрешность интерполяции Эрмита мала по сравнению с погрешностью интегрирования
+		throw_if_not(hermite_error < 1.05 * node_error + 1e-3, "hermite interpolation error exceeds the node error");
+	}
+
+	/**
+	 * @brief Правая часть задачи двух тел для вектора с вариациями (вариации не интегрируются)
+	 */
+	math::vec<55> two_body_ext(math::vec<55> const &v, double)
+	{
+		double r = std::sqrt(sqr(v[0]) + sqr(v[1]) + sqr(v[2]));
+		double mult = -egm::mu / (r * r * r);
+		math::vec<55> out;
+		out[0] = v[3];
+		out[1] = v[4];
+		out[2] = v[5];
+		out[3] = v[0] * mult;
+		out[4] = v[1] * mult;
+		out[5] = v[2] * mult;
+		return out;
+	}
+
+	/**
+	 * @brief Производные ускорения задачи двух тел по положению
+	 */
+	math::mat3x3 two_body_gradient(double const v[3])
+	{
+		double r2 = sqr(v[0]) + sqr(v[1]) + sqr(v[2]);
+		double mult = egm::mu / (r2 * std::sqrt(r2));
+		math::mat3x3 a;
+		for (size_t j{}; j < 3; ++j)
+		{
+			for (size_t k{}; k < 3; ++k)
+			{
+				a[j][k] = mult * (3 * v[j] * v[k] / r2 - double(j == k));
+			}
+		}
+		return a;
+	}
+
+	/**
+	 * @brief Задача двух тел с матрицей изохронных производных 7x7 в плоском векторе (столбцы по 7 элементов,
+	 * седьмой элемент - производная параметра)
+	 */
+	math::vec<55> two_body_flat(math::vec<55> const &v, double)
+	{
+		auto a = two_body_gradient(v.data());
+		auto out = two_body_ext(v, 0);
+		for (size_t i{}; i < 7; ++i)
+		{
+			size_t index{6 + i * 7};
+			for (size_t j{}; j < 3; ++j)
+			{
+				out[index + j] = v[index + j + 3];
+				for (size_t k{}; k < 3; ++k)
+				{
+					out[index + 3 + j] += a[j][k] * v[index + k];
+				}
+			}
+		}
+		return out;
+	}
+
+	/**
+	 * @brief Задача двух тел с матрицей чувствительности по P параметрам (math::variational)
+	 */
+	template <size_t P>
+	typename math::variational<P>::vector two_body_variational(typename math::variational<P>::vector const &v, double)
+	{
+		double r = std::sqrt(sqr(v[0]) + sqr(v[1]) + sqr(v[2]));
+		double mult = -egm::mu / (r * r * r);
+		double ds[6]{v[3], v[4], v[5], v[0] * mult, v[1] * mult, v[2] * mult};
+		return math::variational<P>::derivative(v, ds, two_body_gradient(v.data()), math::mat3x3{});
+	}
+
+	/**
+	 * @brief Правая часть уравнений движения в ГСК (геопотенциал степени N, Солнце, Луна, вращение ГСК)
+	 * для одной траектории и для нескольких траекторий, упакованных по компонентам (math::lockstep)
+	 *
+	 * @tparam C тип счётчика вычислений (std::atomic при вызовах из нескольких потоков)
+	 */
+	template <size_t N, typename C = size_t>
+	struct earth_motion
+	{
+		geopotential_fixed<N> const &gpt;
+		/**
+		 * @brief Начало отсчёта времени (сек с начала 1970 года)
+		 */
+		time_t epoch;
+		C &calls;
+
+		/**
+		 * @brief Положения Солнца и Луны в ГСК
+		 */
+		void bodies(double t, double sun[3], double moon[3]) const
+		{
+			time_t s = epoch + time_t(t);
+			double st = sidereal_time(s), buf[3];
+			solar_model::coordinates(s, buf);
+			transform<abs_cs, ort_cs, grw_cs, ort_cs>::forward(buf, st, sun);
+			lunar_model::coordinates(s, buf);
+			transform<abs_cs, ort_cs, grw_cs, ort_cs>::forward(buf, st, moon);
+		}
+
+		/**
+		 * @brief Ускорения от вращения ГСК, Солнца и Луны
+		 */
+		static void perturbations(double const v[6], double const sun[3], double const moon[3], double out[3])
+		{
+			double solac[3], lunac[3];
+			massforce(v, sun, solar_model::mu(), solac);
+			massforce(v, moon, lunar_model::mu(), lunac);
+			double w = egm::angv;
+			out[0] = w * (w * v[0] + 2 * v[4]) + solac[0] + lunac[0];
+			out[1] = w * (w * v[1] - 2 * v[3]) + solac[1] + lunac[1];
+			out[2] = solac[2] + lunac[2];
+		}
+
+		vec6 operator()(vec6 const &v, double t) const
+		{
+			++calls;
+			double sun[3], moon[3], gptac[3], ac[3];
+			bodies(t, sun, moon);
+			gpt.diffbyxyz(v.data(), gptac);
+			perturbations(v.data(), sun, moon, ac);
+			return vec6{v[3], v[4], v[5], gptac[0] + ac[0], gptac[1] + ac[1], gptac[2] + ac[2]};
+		}
+
+		template <size_t size>
+			requires(size > 6)
+		math::vec<size> operator()(math::vec<size> const &v, double t) const
+		{
+			using batch = math::lockstep<6, size / 6>;
+			constexpr size_t count = batch::width();
+			++calls;
+			double sun[3], moon[3];
+			bodies(t, sun, moon);
+			math::vec<size> out;
+			std::copy(batch::component(v, 3), batch::component(v, 6), out.data());
+			double *ac[3]{batch::component(out, 3), batch::component(out, 4), batch::component(out, 5)};
+			gpt.diffbyxyz(count, batch::component(v, 0), batch::component(v, 1), batch::component(v, 2), ac[0], ac[1], ac[2]);
+			for (size_t k{}; k < count; ++k)
+			{
+				auto p = batch::unpack(v, k);
+				double pert[3];
+				perturbations(p.data(), sun, moon, pert);
+				for (size_t i{}; i < 3; ++i)
+				{
+					ac[i][k] += pert[i];
+				}
+			}
+			return out;
+		}
+	};
+
+	/**
+	 * @brief Грубые ускорения в АСК (геопотенциал 8x8, без Солнца и Луны) для грубой модели Parareal
+	 */
+	struct coarse_motion
+	{
+		geopotential_fixed<8> const &gpt;
+		time_t epoch;
+		size_t &calls;
+
+		vec6 operator()(vec6 const &v, double t) const
+		{
+			++calls;
+			double st = sidereal_time(epoch) + egm::angv * t;
+			double xyz[3], gptac[3];
+			transform<abs_cs, ort_cs, grw_cs, ort_cs>::forward(v.data(), st, xyz);
+			gpt.diffbyxyz(xyz, gptac);
+			math::vec3 out;
+			transform<abs_cs, ort_cs, grw_cs, ort_cs>::backward(gptac, st, out.data());
+			return vec6{v[3], v[4], v[5], out[0], out[1], out[2]};
+		}
+	};
+
+	/**
+	 * @brief Ускорения в АСК (геопотенциал 16x16, Солнце, Луна) для интегрирования полных уравнений и по методу Энке
+	 *
+	 * @tparam C тип счётчика вычислений (std::atomic при вызовах из нескольких потоков)
+	 */
+	template <typename C = size_t>
+	struct inertial_motion
+	{
+		geopotential_fixed<16> const &gpt;
+		time_t epoch;
+		C &calls;
+
+		math::vec3 acceleration(vec6 const &v, double t) const
+		{
+			++calls;
+			// звёздное время меняется непрерывно, положения Солнца и Луны - на целые секунды
+			double st = sidereal_time(epoch) + egm::angv * t;
+			double xyz[3], sun[3], moon[3], buf[3], gptac[3], solac[3], lunac[3];
+			transform<abs_cs, ort_cs, grw_cs, ort_cs>::forward(v.data(), st, xyz);
+			solar_model::coordinates(epoch + time_t(t), buf);
+			transform<abs_cs, ort_cs, grw_cs, ort_cs>::forward(buf, st, sun);
+			lunar_model::coordinates(epoch + time_t(t), buf);
+			transform<abs_cs, ort_cs, grw_cs, ort_cs>::forward(buf, st, moon);
+			gpt.diffbyxyz(xyz, gptac);
+			massforce(xyz, sun, solar_model::mu(), solac);
+			massforce(xyz, moon, lunar_model::mu(), lunac);
+			for (size_t i{}; i < 3; ++i)
+			{
+				buf[i] = gptac[i] + solac[i] + lunac[i];
+			}
+			math::vec3 out;
+			transform<abs_cs, ort_cs, grw_cs, ort_cs>::backward(buf, st, out.data());
+			return out;
+		}
+
+		vec6 operator()(vec6 const &v, double t) const
+		{
+			auto a = acceleration(v, t);
+			return vec6{v[3], v[4], v[5], a[0], a[1], a[2]};
+		}
+
+		/**
+		 * @brief Возмущающее ускорение (без центрального поля)
+		 */
+		math::vec3 perturbation(vec6 const &v, double t) const
+		{
+			auto a = acceleration(v, t);
+			double r = std::sqrt(sqr(v[0]) + sqr(v[1]) + sqr(v[2]));
+			double mult = egm::mu / (r * r * r);
+			return math::vec3{a[0] + v[0] * mult, a[1] + v[1] * mult, a[2] + v[2] * mult};
+		}
+	};
+}
+
+/**
+ * @brief Сравнение интегрирования с постоянным и автоматически выбираемым шагом на высокоэллиптической орбите
+ *
+ */
+void bench_integration()
+{
+	// перигей 7000 км, эксцентриситет 0.7, три витка
+	kepler_orbit orbit{7e6 / 0.3, 0.7};
+	double duration = 3 * orbit.period();
+	std::cout << "integration: fixed step (Adams, Gauss-Jackson) vs adaptive step (RKF 7(8), variable order Adams), HEO e = 0.7, 3 revolutions\n";
+	std::cout << std::setw(20) << "method" << std::setw(10) << "nodes" << std::setw(10) << "calls"
+			  << std::setw(14) << "node err, m" << std::setw(14) << "lagrange, m" << std::setw(14) << "hermite, m" << '\n';
+	for (double step : {30., 10.})
+	{
+		size_t calls{};
+		math::integrator<vec6, double, double> forecast{orbit.initial(), 0., duration, two_body{calls}, step};
+		std::string name = "fixed " + std::to_string(int(step)) + " s";
+		report(name.c_str(), forecast, orbit, duration, calls);
+	}
+	for (double step : {30., 60.})
+	{
+		size_t calls{};
+		math::gauss_jackson<vec6, double, double> forecast{orbit.initial(), 0., duration, two_body{calls}, step};
+		std::string name = "gauss-jackson " + std::to_string(int(step)) + " s";
+		report(name.c_str(), forecast, orbit, duration, calls);
+	}
+	for (double tolerance : {1e-10, 1e-12, 1e-14})
+	{
+		size_t calls{};
+		math::adaptive_integrator<vec6, double, double> forecast{orbit.initial(), 0., duration, two_body{calls}, 60., tolerance};
+		std::ostringstream name;
+		name << "adaptive " << tolerance;
+		report(name.str().c_str(), forecast, orbit, duration, calls);
+	}
+	for (double tolerance : {1e-10, 1e-12, 1e-14})
+	{
+		size_t calls{};
+		math::adams_integrator<vec6, double, double> forecast{orbit.initial(), 0., duration, two_body{calls}, 60., tolerance};
+		std::ostringstream name;
+		name << "adams vsvo " << tolerance;
+		report(name.str().c_str(), forecast, orbit, duration, calls);
+	}
+}
+
+/**
+ * @brief Время вычисления вектора с вариациями (55 компонент) на заданные моменты
+ *
+ */
+void bench_interpolation()
+{
+	kepler_orbit orbit{7e6 / 0.99, 0.01};
+	double duration = 86400;
+	math::vec<55> v;
+	auto initial = orbit.initial();
+	for (size_t i{}; i < 6; ++i)
+	{
+		v[i] = initial[i];
+	}
+	math::integrator<math::vec<55>, double, double> forecast{v, 0., duration, two_body_ext, 30.};
+	// моменты измерений на часовом участке (сеанс наблюдений), по нескольку на шаг интегрирования
+	constexpr size_t count{1000}, repeat{100};
+	std::vector<double> times(count);
+	for (size_t i{}; i < count; ++i)
+	{
+		times[i] = 3600. * i / count;
+	}
+	// все варианты записывают векторы целиком, как при вычислении невязок
+	std::vector<math::vec<55>> points(count);
+	double sum{};
+	auto start = std::chrono::steady_clock::now();
+	for (size_t r{}; r < repeat; ++r)
+	{
+		for (size_t i{}; i < count; ++i)
+		{
+			points[i] = forecast.point<4>(times[i]);
+		}
+		sum += points.back()[0];
+	}
+	auto lagrange = std::chrono::steady_clock::now();
+	for (size_t r{}; r < repeat; ++r)
+	{
+		for (size_t i{}; i < count; ++i)
+		{
+			points[i] = forecast.point(times[i]);
+		}
+		sum += points.back()[0];
+	}
+	auto hermite = std::chrono::steady_clock::now();
+	for (size_t r{}; r < repeat; ++r)
+	{
+		forecast.points(times, points);
+		sum += points.back()[0];
+	}
+	auto batch = std::chrono::steady_clock::now();
+	if (std::isnan(sum))
+	{
+		std::cout << "nan\n";
+	}
+	using ns = std::chrono::duration<double, std::nano>;
+	std::cout << "interpolation of vec<55>, ns per point: lagrange " << ns(lagrange - start).count() / (count * repeat)
+			  << ", hermite " << ns(hermite - lagrange).count() / (count * repeat) << ", batch " << ns(batch - hermite).count() / (count * repeat) << '\n';
+}
+
+void bench_streaming()
+{
+	kepler_orbit orbit{7e6 / 0.99, 0.01};
+	// две недели
+	double duration = 14 * 86400;
+	math::vec<55> v;
+	auto initial = orbit.initial();
+	for (size_t i{}; i < 6; ++i)
+	{
+		v[i] = initial[i];
+	}
+	using integrator = math::integrator<math::vec<55>, double, double>;
+	// сеансы наблюдений по 10 минут раз в сутки
+	std::vector<double> times;
+	for (size_t day{}; day < 14; ++day)
+	{
+		for (size_t i{}; i < 100; ++i)
+		{
+			times.push_back(day * 86400. + 6. * i);
+		}
+	}
+	auto start = std::chrono::steady_clock::now();
+	integrator forecast{v, 0., duration, two_body_ext, 30.};
+	std::vector<math::vec<55>> stored = forecast.points(times);
+	auto middle = std::chrono::steady_clock::now();
+	std::vector<math::vec<55>> streamed(times.size());
+	integrator::stream(v, 0., duration, two_body_ext, 30., times, streamed);
+	auto finish = std::chrono::steady_clock::now();
+	double diff{};
+	for (size_t i{}; i < times.size(); ++i)
+	{
+		for (size_t k{}; k < 55; ++k)
+		{
+			diff = std::max(diff, std::abs(stored[i][k] - streamed[i][k]));
+		}
+	}
+	size_t bytes = forecast._points.capacity() * sizeof(integrator::pair);
+	using ms = std::chrono::duration<double, std::milli>;
+	std::cout << "streaming vec<55> over 14 days: stored " << ms(middle - start).count() << " ms, " << bytes / (1 << 20) << " MB of nodes; "
+			  << "streamed " << ms(finish - middle).count() << " ms, " << streamed.size() * sizeof(math::vec<55>) / 1024 << " KB of outputs; "
+			  << "max difference " << diff << '\n';
+	throw_if_not(diff == 0, "stored and streamed forecasts differ");
+}
+
+/**
+ * @brief Продолжение интегрирования скользящего окна вместо интегрирования заново
+ *
+ */
+void bench_extension()
+{
+	kepler_orbit orbit{7e6 / 0.99, 0.01};
+	using integrator = math::integrator<vec6, double, double>;
+	size_t full_calls{}, calls{}, short_calls{};
+	integrator full{orbit.initial(), 0., 86400., two_body{full_calls}, 30.};
+	// окно в 12 часов сдвигается на 6 часов с продолжением интегрирования
+	integrator forecast{orbit.initial(), 0., 21600., two_body{calls}, 30.};
+	for (double tk : {43200., 64800., 86400.})
+	{
+		forecast.trim(tk - 43200.);
+		forecast.extend_to(tk, two_body{calls});
+	}
+	// продолжение до завершения разгона
+	integrator small{orbit.initial(), 0., 60., two_body{short_calls}, 30.};
+	small.extend_to(86400., two_body{short_calls});
+	auto difference = [&full](integrator const &other)
+	{
+		double diff{};
+		for (double t = other._points.front().t; t < 86400.; t += 7)
+		{
+			auto l = full.point(t), r = other.point(t);
+			for (size_t i{}; i < 6; ++i)
+			{
+				diff = std::max(diff, std::abs(l[i] - r[i]));
+			}
+		}
+		return diff;
+	};
+	double window_diff = difference(forecast), small_diff = difference(small);
+	std::cout << "extension to 1 day: full run " << full_calls << " calls; sliding 12 h window "
+			  << forecast._points.size() << " nodes, " << calls << " calls, max difference " << window_diff
+			  << "; from 3 nodes " << short_calls << " calls, max difference " << small_diff << '\n';
+	throw_if_not(window_diff == 0 && small_diff == 0, "extended and full forecasts differ");
+}
+
+/**
+ * @brief Интегрирование в обе стороны от середины промежутка в двух потоках и последовательно
+ *
+ */
+void bench_bidirectional()
+{
+	kepler_orbit orbit{7e6 / 0.99, 0.01};
+	math::vec<55> v;
+	auto initial = orbit.initial();
+	for (size_t i{}; i < 6; ++i)
+	{
+		v[i] = initial[i];
+	}
+	// по неделе в каждую сторону
+	double week = 7 * 86400;
+	using integrator = math::integrator<math::vec<55>, double, double>;
+	auto start = std::chrono::steady_clock::now();
+	integrator backward{v, 0., -week, two_body_ext, -30.};
+	integrator forward{v, 0., week, two_body_ext, 30.};
+	auto middle = std::chrono::steady_clock::now();
+	math::bidirectional_integrator<math::vec<55>, double, double> forecast{v, 0., -week, week, two_body_ext, 30.};
+	auto finish = std::chrono::steady_clock::now();
+	std::vector<double> times;
+	for (double t = -week; t <= week; t += 100)
+	{
+		times.push_back(t);
+	}
+	auto points = forecast.points(times);
+	double diff{}, error{}, exact[2];
+	for (size_t i{}; i < times.size(); ++i)
+	{
+		auto expected = times[i] < 0 ? backward.point(times[i]) : forward.point(times[i]);
+		diff = std::max(diff, std::abs(expected[0] - points[i][0]) + std::abs(expected[1] - points[i][1]));
+		orbit.position(times[i], exact);
+		error = std::max(error, std::sqrt(sqr(points[i][0] - exact[0]) + sqr(points[i][1] - exact[1])));
+	}
+	using ms = std::chrono::duration<double, std::milli>;
+	std::cout << "bidirectional vec<55> over +-7 days (" << std::thread::hardware_concurrency() << " hardware threads): sequential "
+			  << ms(middle - start).count() << " ms, two threads " << ms(finish - middle).count() << " ms, max difference " << diff
+			  << " m, position error " << error << " m\n";
+	throw_if_not(diff == 0, "bidirectional and one-way forecasts differ");
+	throw_if_not(error < 10, "bidirectional position error exceeds 10 m");
+}
+
+/**
+ * @brief Численные производные по начальному вектору: опорная траектория и 6 вариаций интегрируются
+ * независимо (последовательно и в отдельных потоках) и совместно группами по размеру пакета геопотенциала
+ * (по компонентам, с вычислением положений Солнца и Луны один раз на этап), группы - в отдельных потоках
+ *
+ */
+void bench_lockstep()
+{
+	geopotential_fixed<16> gpt;
+	// круговая орбита высотой 500 км с наклонением 60 градусов
+	double r = egm::rad + 5e5, speed = std::sqrt(egm::mu / r), incl = math::pi / 3;
+	vec6 nominal{r, 0, 0, 0, speed * std::cos(incl), speed * std::sin(incl)};
+	constexpr double variations[6]{25, 25, 25, .25, .25, .25};
+	std::vector<vec6> states(7, nominal);
+	for (size_t i{}; i < 6; ++i)
+	{
+		states[i][i] += variations[i];
+	}
+	using batch = math::lockstep<6, math::simd::dpack::size>;
+	constexpr size_t width = batch::width();
+	size_t groups = (states.size() + width - 1) / width;
+	double duration = 86400;
+	std::atomic<size_t> calls{};
+	earth_motion<16, std::atomic<size_t>> model{gpt, 1704067200, calls};
+	using single_type = math::integrator<vec6, double, double>;
+	using batch_type = math::integrator<batch::batch, double, double>;
+	using ms = std::chrono::duration<double, std::milli>;
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<single_type> single;
+	for (auto const &v : states)
+	{
+		single.emplace_back(v, 0., duration, model, 30.);
+	}
+	double sequential_time = ms(std::chrono::steady_clock::now() - start).count();
+	size_t single_calls = calls;
+
+	start = std::chrono::steady_clock::now();
+	std::vector<std::optional<single_type>> parallel(states.size());
+	par::parallel_for(size_t{}, states.size(), [&](size_t k)
+					  { parallel[k].emplace(states[k], 0., duration, model, 30.); });
+	double parallel_time = ms(std::chrono::steady_clock::now() - start).count();
+
+	calls = 0;
+	start = std::chrono::steady_clock::now();
+	std::vector<std::optional<batch_type>> lockstep(groups);
+	par::parallel_for(size_t{}, groups, [&](size_t g)
+					  {
+						  auto first = states.begin() + g * width;
+						  std::vector<vec6> group(first, first + std::min(width, states.size() - g * width));
+						  lockstep[g].emplace(batch::pack(group), 0., duration, model, 30.); });
+	double lockstep_time = ms(std::chrono::steady_clock::now() - start).count();
+	// вектор траектории k в узле n
+	auto packed = [&](size_t n, size_t k)
+	{ return batch::unpack(lockstep[k / width]->_points[n].v, k % width); };
+	// расхождение положений в узлах и расхождение производных по начальному вектору (в конце промежутка)
+	double diff{}, jacobian{};
+	size_t last = single.front()._points.size() - 1;
+	for (size_t n{}; n <= last; ++n)
+	{
+		for (size_t k{}; k < states.size(); ++k)
+		{
+			auto p = packed(n, k);
+			auto const &q = single[k]._points[n].v;
+			diff = std::max(diff, std::sqrt(sqr(p[0] - q[0]) + sqr(p[1] - q[1]) + sqr(p[2] - q[2])));
+		}
+	}
+	for (size_t k{}; k < 6; ++k)
+	{
+		for (size_t i{}; i < 6; ++i)
+		{
+			double together = (packed(last, k)[i] - packed(last, 6)[i]) / variations[k];
+			double separate = (single[k]._points.back().v[i] - single[6]._points.back().v[i]) / variations[k];
+			jacobian = std::max(jacobian, std::abs(together - separate));
+		}
+	}
+	std::cout << "numeric jacobian, 7 trajectories over 1 day (" << std::thread::hardware_concurrency() << " hardware threads): independent "
+			  << sequential_time << " ms sequential, " << parallel_time << " ms parallel (" << single_calls << " calls); lockstep groups of "
+			  << width << " in parallel " << lockstep_time << " ms (" << calls << " calls), speedup over parallel " << parallel_time / lockstep_time
+			  << "; max position difference " << diff << " m, max derivative difference " << jacobian << '\n';
+	throw_if_not(diff < 1e-3, "lockstep and independent positions differ by more than 1 mm");
+	throw_if_not(jacobian < 1e-3, "lockstep and independent derivatives differ by more than 1e-3");
+}
+
+/**
+ * @brief Интегрирование на 2 недели по отрезкам (Parareal) в АСК: точная модель - метод Адамса с шагом 30 с,
+ * грубая - геопотенциал 8x8 без Солнца и Луны, проинтегрированный методом Гаусса-Джексона с шагом 2 мин
+ * (правая часть вычисляется в несколько раз реже и дешевле), в сравнении с последовательным интегрированием точной моделью.
+ * Итерации прекращаются при изменении векторов на границах отрезков менее 1e-7 (около 0.7 м),
+ * что меньше погрешности последовательного интегрирования; итераций требуется не больше четверти кол-ва отрезков.
+ * Выигрыш по времени возможен только при потоке на каждый отрезок: тогда измеренное ускорение проверяется.
+ * При меньшем кол-ве потоков Parareal медленнее последовательного интегрирования, и ускорение при потоке на отрезок
+ * оценивается по длине самого долгого пути (ideal speedup): вычисления точной модели на нём (с разгоном отрезков)
+ * и все последовательные вычисления грубой модели.
+ *
+ */
+void bench_parareal()
+{
+	geopotential_fixed<16> gpt;
+	double r = egm::rad + 5e5, speed = std::sqrt(egm::mu / r), incl = math::pi / 3;
+	vec6 v{r, 0, 0, 0, speed * std::cos(incl), speed * std::sin(incl)};
+	double duration = 14 * 86400;
+	std::atomic<size_t> fine_calls{};
+	size_t coarse_calls{};
+	inertial_motion<std::atomic<size_t>> fine{gpt, 1704067200, fine_calls};
+	geopotential_fixed<8> gpt8;
+	coarse_motion model{gpt8, 1704067200, coarse_calls};
+	double step = 120;
+	using ms = std::chrono::duration<double, std::milli>;
+	// время грубой модели (вызывается последовательно)
+	double coarse_time{};
+	auto coarse = [&](vec6 const &u, double tn, double tk)
+	{
+		auto start = std::chrono::steady_clock::now();
+		vec6 out = math::gauss_jackson<vec6, double, double>{u, tn, tk, model, step}.point(tk);
+		coarse_time += ms(std::chrono::steady_clock::now() - start).count();
+		return out;
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	math::integrator<vec6, double, double> serial{v, 0., duration, fine, 30.};
+	double serial_time = ms(std::chrono::steady_clock::now() - start).count();
+	size_t serial_calls = fine_calls;
+	// стоимость вычисления точной правой части
+	double fine_cost = serial_time / serial_calls;
+	std::vector<double> times;
+	for (double t{}; t <= duration; t += 60)
+	{
+		times.push_back(t);
+	}
+	auto expected = serial.points(times);
+	// погрешность последовательного интегрирования (по сравнению с шагом 15 с) для сопоставления с расхождением
+	math::integrator<vec6, double, double> reference{v, 0., duration, fine, 15.};
+	auto exact = reference.points(times);
+	double error{};
+	for (size_t i{}; i < times.size(); ++i)
+	{
+		error = std::max(error, std::sqrt(sqr(exact[i][0] - expected[i][0]) + sqr(exact[i][1] - expected[i][1]) + sqr(exact[i][2] - expected[i][2])));
+	}
+	unsigned threads = std::thread::hardware_concurrency();
+	std::cout << "parareal over 14 days (" << threads << " hardware threads): serial "
+			  << serial_time << " ms, " << serial_calls << " calls, error " << error << " m\n";
+	std::cout << std::setw(8) << "slices" << std::setw(12) << "iterations" << std::setw(12) << "time, ms" << std::setw(10) << "speedup"
+			  << std::setw(14) << "fine calls" << std::setw(12) << "path calls" << std::setw(14) << "coarse calls"
+			  << std::setw(16) << "ideal speedup" << std::setw(14) << "difference" << std::setw(11) << "converged\n";
+	for (size_t slices : {32, 64, 128})
+	{
+		fine_calls = 0;
+		coarse_calls = 0;
+		coarse_time = 0;
+		auto start = std::chrono::steady_clock::now();
+		math::parareal_integrator<vec6, double, double> forecast{v, 0., duration, fine, 30., coarse, slices, 1e-7, 16};
+		double time = ms(std::chrono::steady_clock::now() - start).count();
+		auto points = forecast.points(times);
+		double diff{};
+		for (size_t i{}; i < times.size(); ++i)
+		{
+			diff = std::max(diff, std::sqrt(sqr(points[i][0] - expected[i][0]) + sqr(points[i][1] - expected[i][1]) + sqr(points[i][2] - expected[i][2])));
+		}
+		double path = forecast._path * fine_cost + coarse_time;
+		std::cout << std::setw(8) << slices << std::setw(12) << forecast._iterations << std::setw(12) << time << std::setw(10) << serial_time / time
+				  << std::setw(14) << fine_calls << std::setw(12) << forecast._path << std::setw(14) << coarse_calls
+				  << std::setw(16) << serial_time / path << std::setw(14) << diff << std::setw(10) << forecast._converged << '\n';
+		throw_if_not(forecast._converged, "parareal did not converge");
+		throw_if_not(diff < error, "parareal difference exceeds the serial integration error");
+		throw_if_not(4 * forecast._iterations <= slices, "parareal needs more than a quarter of the slices as iterations");
+		if (threads >= slices)
+		{
+			throw_if_not(time < serial_time, "parareal is slower than serial integration with a thread per slice");
+		}
+	}
+}
+
+/**
+ * @brief Интегрирование полных уравнений движения и отклонения от кеплеровой орбиты (метод Энке) с разными шагами
+ * на околокруговой и эллиптической орбитах (погрешность - по сравнению с интегрированием полных уравнений с шагом 5 с)
+ *
+ */
+void bench_encke()
+{
+	geopotential_fixed<16> gpt;
+	size_t calls{};
+	inertial_motion<> model{gpt, 1704067200, calls};
+	auto perturbation = [&model](vec6 const &v, double t)
+	{ return model.perturbation(v, t); };
+	double duration = 86400, incl = math::pi / 3;
+	std::vector<double> times;
+	for (double t{}; t <= duration - 600; t += 60)
+	{
+		times.push_back(t);
+	}
+	auto error = [&](auto const &forecast, std::vector<vec6> const &expected)
+	{
+		auto points = forecast.points(times);
+		double out{};
+		for (size_t i{}; i < times.size(); ++i)
+		{
+			out = std::max(out, std::sqrt(sqr(points[i][0] - expected[i][0]) + sqr(points[i][1] - expected[i][1]) + sqr(points[i][2] - expected[i][2])));
+		}
+		return out;
+	};
+	std::cout << std::setw(20) << "method" << std::setw(10) << "step" << std::setw(10) << "calls"
+			  << std::setw(16) << "rectifications" << std::setw(14) << "error, m\n";
+	for (double e : {0.001, 0.1})
+	{
+		// перигей на высоте 500 км
+		double rp = egm::rad + 5e5, speed = std::sqrt(egm::mu * (1 + e) / rp);
+		vec6 v{rp, 0, 0, 0, speed * std::cos(incl), speed * std::sin(incl)};
+		std::cout << "eccentricity " << e << '\n';
+		math::integrator<vec6, double, double> reference{v, 0., duration, model, 5.};
+		auto expected = reference.points(times);
+		// погрешности метода Коуэлла с шагами 60 и 120 с
+		double cowell[2]{};
+		for (double step : {30., 60., 120.})
+		{
+			calls = 0;
+			math::integrator<vec6, double, double> forecast{v, 0., duration, model, step};
+			double out = error(forecast, expected);
+			std::cout << std::setw(20) << "cowell" << std::setw(10) << step << std::setw(10) << calls
+					  << std::setw(16) << "-" << std::setw(14) << out << '\n';
+			if (step > 30)
+			{
+				cowell[step > 60] = out;
+			}
+		}
+		for (double step : {60., 120., 240.})
+		{
+			calls = 0;
+			encke_integrator<double, double> forecast{v, 0., duration, perturbation, step};
+			double out = error(forecast, expected);
+			std::cout << std::setw(20) << "encke" << std::setw(10) << step << std::setw(10) << calls
+					  << std::setw(16) << forecast.rectifications() << std::setw(14) << out << '\n';
+			if (step < 240)
+			{
+				throw_if_not(out < cowell[step > 60], "encke is less accurate than cowell with the same step");
+			}
+		}
+	}
+}
+
+/**
+ * @brief Сжатие прогноза в кусочные разложения по полиномам Чебышёва: объём, погрешность и время вычисления векторов
+ *
+ */
+void bench_ephemeris()
+{
+	geopotential_fixed<16> gpt;
+	size_t calls{};
+	earth_motion<16> model{gpt, 1704067200, calls};
+	double r = egm::rad + 5e5, speed = std::sqrt(egm::mu / r), incl = math::pi / 3;
+	vec6 v{r, 0, 0, 0, speed * std::cos(incl), speed * std::sin(incl)};
+	double duration = 7 * 86400.;
+	using forecast_type = math::integrator<vec6, double, double>;
+	using ephemeris_type = math::chebyshev_ephemeris<vec6, double>;
+	forecast_type forecast{v, 0., duration, model, 30.};
+	auto source = [&forecast](double t)
+	{ return forecast.point(t); };
+	size_t stored = forecast._points.size() * sizeof(forecast_type::pair);
+	// векторы и моменты узлов (без производных), т.е. наименьшее хранение прогноза с интерполяцией
+	size_t vectors = forecast._points.size() * (sizeof(vec6) + sizeof(double));
+	std::vector<double> times;
+	for (double t{}; t <= duration; t += 7)
+	{
+		times.push_back(t);
+	}
+	using ms = std::chrono::duration<double, std::milli>;
+	auto start = std::chrono::steady_clock::now();
+	auto expected = forecast.points(times);
+	double forecast_time = ms(std::chrono::steady_clock::now() - start).count();
+	std::cout << "ephemeris over 7 days: forecast " << stored / 1024 << " KB (vectors and times " << vectors / 1024 << " KB), "
+			  << times.size() << " lookups " << forecast_time << " ms\n";
+	std::cout << std::setw(12) << "tolerance" << std::setw(8) << "degree" << std::setw(10) << "segments" << std::setw(10) << "KB" << std::setw(10) << "ratio"
+			  << std::setw(14) << "fit, ms" << std::setw(14) << "lookups, ms" << std::setw(14) << "pos err, m" << std::setw(14) << "vel err, m/s" << '\n';
+	for (double tolerance : {1., 1e-1})
+	{
+		start = std::chrono::steady_clock::now();
+		// хранятся разложения положений, скорости вычисляются дифференцированием (время в секундах)
+		ephemeris_type ephemeris{source, 0., duration, tolerance, 1.};
+		double fit_time = ms(std::chrono::steady_clock::now() - start).count();
+		start = std::chrono::steady_clock::now();
+		auto actual = ephemeris.points(times);
+		double lookup_time = ms(std::chrono::steady_clock::now() - start).count();
+		double position{}, velocity{};
+		for (size_t i{}; i < times.size(); ++i)
+		{
+			for (size_t k{}; k < 3; ++k)
+			{
+				position = std::max(position, std::abs(actual[i][k] - expected[i][k]));
+				velocity = std::max(velocity, std::abs(actual[i][k + 3] - expected[i][k + 3]));
+			}
+		}
+		size_t bytes = ephemeris.size() * sizeof(double);
+		std::cout << std::setw(12) << tolerance << std::setw(8) << ephemeris.degree() << std::setw(10) << ephemeris.count() << std::setw(10) << bytes / 1024
+				  << std::setw(10) << double(vectors) / bytes << std::setw(14) << fit_time << std::setw(14) << lookup_time
+				  << std::setw(14) << position << std::setw(14) << velocity << '\n';
+		throw_if_not(position <= tolerance && velocity <= tolerance, "ephemeris exceeds the tolerance");
+		throw_if_not(vectors >= 10 * bytes, "ephemeris is less than 10 times smaller than the forecast vectors and times");
+		// запись и чтение файла не меняют векторов
+		auto path = (std::filesystem::temp_directory_path() / "ephemeris.bin").string();
+		ephemeris.save(path);
+		auto loaded = ephemeris_type::load(path);
+		std::filesystem::remove(path);
+		auto reloaded = loaded.points(times);
+		for (size_t i{}; i < times.size(); ++i)
+		{
+			for (size_t k{}; k < 6; ++k)
+			{
+				throw_if_not(reloaded[i][k] == actual[i][k], "ephemeris file round trip changes vectors");
+			}
+		}
+	}
+}
+
+/**
+ * @brief Счётчики интегратора и время вычисления слагаемых правой части (собираются при BALLISTIC_STATISTICS)
+ *
+ */
+void bench_statistics()
+{
+	geopotential_fixed<16> gpt;
+	size_t calls{};
+	earth_motion<16> model{gpt, 1704067200, calls};
+	math::statistics terms;
+	auto timed_model = [&](vec6 const &v, double t)
+	{
+		++calls;
+		double sun[3], moon[3], gptac[3], ac[3];
+		math::timed(terms, math::force_term::bodies, [&]
+					{ model.bodies(t, sun, moon); });
+		math::timed(terms, math::force_term::geopotential, [&]
+					{ gpt.diffbyxyz(v.data(), gptac); });
+		math::timed(terms, math::force_term::bodies, [&]
+					{ model.perturbations(v.data(), sun, moon, ac); });
+		return vec6{v[3], v[4], v[5], gptac[0] + ac[0], gptac[1] + ac[1], gptac[2] + ac[2]};
+	};
+	double r = egm::rad + 5e5, speed = std::sqrt(egm::mu / r), incl = math::pi / 3;
+	vec6 v{r, 0, 0, 0, speed * std::cos(incl), speed * std::sin(incl)};
+	std::vector<double> times;
+	for (double t{}; t <= 86400; t += 7)
+	{
+		times.push_back(t);
+	}
+	using integrator = math::integrator<vec6, double, double>;
+	using ms = std::chrono::duration<double, std::milli>;
+	auto start = std::chrono::steady_clock::now();
+	integrator forecast{v, 0., 86400., timed_model, 30.};
+	auto stored = forecast.points(times);
+	math::statistics streamed_stats;
+	std::vector<vec6> streamed(times.size());
+	integrator::stream(v, 0., 86400., timed_model, 30., times, streamed, &streamed_stats);
+	double elapsed = ms(std::chrono::steady_clock::now() - start).count();
+	math::statistics total = forecast._stats;
+	total += streamed_stats;
+	total += terms;
+	std::cout << "statistics " << (math::statistics_enabled ? "enabled" : "disabled") << ": stored and streamed forecasts over a day "
+			  << elapsed << " ms, " << calls << " model calls\n";
+	if constexpr (math::statistics_enabled)
+	{
+		std::cout << "  stored: " << forecast._stats.calls << " calls, " << forecast._stats.steps << " steps, " << forecast._stats.queries << " queries\n"
+				  << "  streamed: " << streamed_stats.calls << " calls, " << streamed_stats.steps << " steps, " << streamed_stats.queries << " queries\n"
+				  << "  total: " << total.calls << " calls; geopotential " << total.time(math::force_term::geopotential) * 1e-6
+				  << " ms, bodies " << total.time(math::force_term::bodies) * 1e-6 << " ms\n";
+		throw_if_not(total.calls == calls, "statistics call count mismatch");
+	}
+}
+
+/**
+ * @brief Интегрирование матрицы изохронных производных в плоском векторе 7x7 и в math::variational
+ *
+ */
+void bench_variational()
+{
+	kepler_orbit orbit{7e6 / 0.99, 0.01};
+	auto initial = orbit.initial();
+	double duration = 86400;
+	using ms = std::chrono::duration<double, std::milli>;
+	size_t repeat{20};
+	math::vec<55> flat;
+	std::copy(initial.data(), initial.data() + 6, flat.data());
+	for (size_t i{}; i < 7; ++i)
+	{
+		flat[6 + 8 * i] = 1;
+	}
+	auto start = std::chrono::steady_clock::now();
+	math::vec<55> flat_end;
+	for (size_t i{}; i < repeat; ++i)
+	{
+		math::integrator<math::vec<55>, double, double> forecast{flat, 0., duration, two_body_flat, 30.};
+		flat_end = forecast._points.back().v;
+	}
+	double flat_time = ms(std::chrono::steady_clock::now() - start).count() / repeat;
+	std::cout << "variational equations over a day, ms: flat 7x7 " << flat_time;
+	auto run = [&]<size_t P>(std::integral_constant<size_t, P>)
+	{
+		using variations = math::variational<P>;
+		typename variations::vector end;
+		start = std::chrono::steady_clock::now();
+		for (size_t i{}; i < repeat; ++i)
+		{
+			math::integrator<typename variations::vector, double, double> forecast{variations::initial(initial.data()), 0., duration, two_body_variational<P>, 30.};
+			end = forecast._points.back().v;
+		}
+		double time = ms(std::chrono::steady_clock::now() - start).count() / repeat;
+		double diff{};
+		for (size_t i{}; i < 6; ++i)
+		{
+			for (size_t j{}; j < 6; ++j)
+			{
+				diff = std::max(diff, std::abs(variations::sensitivity(end, i, j) - flat_end[6 + j * 7 + i]));
+			}
+		}
+		std::cout << ", variational<" << P << "> " << time << " (max difference " << diff << ")";
+		throw_if_not(diff < 1e-9, "variational and flat sensitivities differ");
+	};
+	run(std::integral_constant<size_t, 7>{});
+	run(std::integral_constant<size_t, 6>{});
+	std::cout << '\n';
+}
@@ -0,0 +1,57 @@
+#include <auxiliaries.hpp>
+#include <gptstore.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+namespace
+{
+	/**
+	 * @brief Время загрузки гармоник в мс
+	 */
+	double measure(std::string const &path, size_t degree)
+	{
+		auto start = std::chrono::steady_clock::now();
+		egm::load_harmonics(path, degree);
+		auto finish = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(finish - start).count();
+	}
+}
+
+/**
+ * @brief Сравнение времени загрузки гармоник из текстового и двоичного файлов
+ *
+ * @param path путь к текстовому файлу гармоник
+ */
+void bench_store(char const *path)
+{
+	std::string binpath = std::string{path} + ".bin";
+	egm::convert_harmonics(path, binpath);
+	std::cout << "harmonics loading: text vs binary\n";
+	std::cout << std::setw(6) << "degree" << std::setw(14) << "text, ms" << std::setw(14) << "binary, ms" << '\n';
+	for (size_t degree : {16, 36, 70, 360})
+	{
+		double text_time = measure(path, degree);
+		double bin_time = measure(binpath, degree);
+		std::cout << std::setw(6) << degree << std::setw(14) << text_time << std::setw(14) << bin_time << '\n';
+	}
+	{
+		// одни и те же гармоники, загруженные в реестр из текстового и двоичного файлов
+		auto &registry = egm::gravity_registry::global();
+		geopotential text_gpt{registry.load("text", path), 70};
+		geopotential bin_gpt{registry.load("binary", binpath), 70};
+		double in[3]{3e6, -4e6, 4.5e6}, text_out[3], bin_out[3];
+		text_gpt.diffbyxyz(in, text_out);
+		bin_gpt.diffbyxyz(in, bin_out);
+		bool equal = std::equal(std::begin(text_out), std::end(text_out), std::begin(bin_out));
+		std::cout << "registry: text and binary models " << (equal ? "agree" : "differ") << '\n';
+		throw_if_not(equal, "text and binary models differ");
+		registry.remove("text");
+		registry.remove("binary");
+	}
+	// отображение файла закрывается вместе с последней ссылкой на модель
+	std::remove(binpath.c_str());
+}
@@ -0,0 +1,27 @@
+#include <gptstore.hpp>
+#include <exception>
+#include <iostream>
+
+/**
+ * @brief Преобразование текстового файла гармоник геопотенциала в двоичный формат.
+ * Аргументы командной строки: путь к текстовому файлу и путь к двоичному файлу.
+ *
+ */
+int main(int argc, char **argv)
+{
+	if (argc < 3)
+	{
+		std::cout << "usage: gptconvert <text file> <binary file>\n";
+		return 1;
+	}
+	try
+	{
+		size_t degree = egm::convert_harmonics(argv[1], argv[2]);
+		std::cout << "Converted harmonics up to degree " << degree << " into " << argv[2] << std::endl;
+	}
+	catch (std::exception const &ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return 1;
+	}
+}
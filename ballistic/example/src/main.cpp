@@ -0,0 +1,60 @@
+#include <gptstore.hpp>
+#include <exception>
+#include <iostream>
+
+void bench_store(char const *path);
+void bench_gpt();
+void bench_adaptive_gpt();
+void bench_gpt_field();
+void bench_fixed_gpt();
+void bench_streaming_gpt();
+void bench_mixed_gpt(char const *egmpath, char const *jgmpath);
+void bench_integration();
+void bench_interpolation();
+void bench_streaming();
+void bench_extension();
+void bench_bidirectional();
+void bench_lockstep();
+void bench_parareal();
+void bench_encke();
+void bench_ephemeris();
+void bench_statistics();
+void bench_variational();
+
+/**
+ * @brief Первый аргумент командной строки - путь к файлу с гармониками геопотенциала egm96, второй - к файлу гармоник jgm3
+ *
+ */
+int main(int argc, char **argv)
+{
+	try
+	{
+		char const *path = argc > 1 ? argv[1] : "resources/egm96.txt";
+		char const *jgmpath = argc > 2 ? argv[2] : "resources/jgm3.txt";
+		bench_store(path);
+		egm::load_harmonics(path);
+		bench_gpt();
+		bench_adaptive_gpt();
+		bench_fixed_gpt();
+		bench_streaming_gpt();
+		bench_mixed_gpt(path, jgmpath);
+		bench_gpt_field();
+		bench_integration();
+		bench_interpolation();
+		bench_streaming();
+		bench_extension();
+		bench_bidirectional();
+		bench_lockstep();
+		bench_parareal();
+		bench_encke();
+		bench_ephemeris();
+		bench_statistics();
+		bench_variational();
+		std::cout << "All benchmarks are completed.\n";
+	}
+	catch (std::exception const &ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return 1;
+	}
+}
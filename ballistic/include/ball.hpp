@@ -1,5 +1,7 @@
 #pragma once
 #include <vector>
+#include <memory>
+#include <string>
 
 /**
  * @brief Кол-во секунд, прошедщих с начала 1970 г
@@ -43,6 +45,25 @@ namespace egm
 	 * @brief Количество гармоник геопотенциала в модели геопотенциала
 	 */
 	constexpr inline size_t count{360};
+	/**
+	 * @brief Кол-во гармоник в разложении до степени degree включительно
+	 */
+	constexpr inline size_t harmonics_count(size_t degree)
+	{
+		return (degree + 1) * (degree + 2) / 2;
+	}
+	/**
+	 * @brief Старшая степень, все гармоники которой содержатся в массиве из size гармоник (size > 0)
+	 */
+	constexpr inline size_t harmonics_degree(size_t size)
+	{
+		size_t degree{};
+		while (harmonics_count(degree + 1) <= size)
+		{
+			++degree;
+		}
+		return degree;
+	}
 	/**
 	 * @brief Массив грамоник геопотенциала
 	 */
@@ -57,7 +78,7 @@ namespace egm
 	template <typename iterator>
 	void read_harmonics(iterator begin, iterator end)
 	{
-		egm::harmonics.resize((egm::count + 1) * (egm::count + 2) / 2);
+		egm::harmonics.resize(harmonics_count(egm::count));
 		for (auto iter = egm::harmonics.begin(); begin != end; ++begin, ++iter)
 		{
 			*iter = *begin;
@@ -75,11 +96,159 @@ struct trigonometric_func
 };
 
 /**
- * @brief Гравитационный потенциал Земли
+ * @brief Порядок производных, вычисляемых вместе с потенциалом
  *
  */
-class geopotential
+enum struct gpt_order
+{
+	/**
+	 * @brief Только значение потенциала
+	 */
+	value,
+	/**
+	 * @brief Значение и вектор производных по координатам
+	 */
+	gradient,
+	/**
+	 * @brief Значение, вектор производных и матрица вторых производных по координатам
+	 */
+	hessian
+};
+
+/**
+ * @brief Способ вычисления потенциала
+ *
+ */
+enum struct gpt_engine
+{
+	/**
+	 * @brief Через сферические координаты (широта, долгота)
+	 */
+	spherical,
+	/**
+	 * @brief Через декартовы координаты и направляющие косинусы (по Пайнсу), без тригонометрических функций и особенности на полюсах
+	 */
+	cartesian,
+	/**
+	 * @brief По Пайнсу обходом по столбцам порядка m без хранения треугольника полиномов (для больших степеней разложения)
+	 */
+	streaming,
+	/**
+	 * @brief Через сферические координаты, степени выше порога суммируются в одинарной точности (пакетами float) с накоплением в double.
+	 * Вторые производные всегда вычисляются в двойной точности. Пакеты float требуют AVX2/FMA (процессор и сборка с BALLISTIC_AVX2):
+	 * без них суммирование в float медленнее, чем в double, и все степени суммируются в двойной точности, как в spherical.
+	 */
+	mixed
+};
+
+/**
+ * @brief Значения потенциала и его производных в ГСК
+ *
+ */
+struct gpt_values
 {
+	/**
+	 * @brief Значение потенциала
+	 */
+	double u;
+	/**
+	 * @brief Вектор производных (du/dx, du/dy, du/dz)
+	 */
+	double du[3];
+	/**
+	 * @brief Матрица вторых производных
+	 */
+	double ddu[3][3];
+};
+
+/**
+ * @brief Таблица коэффициентов рекуррентных соотношений для полиномов Лежандра
+ *
+ */
+struct legendre_coefficients;
+
+/**
+ * @brief Гармоники и множители рекурсии, упорядоченные по порядку m (для обхода по столбцам)
+ *
+ */
+struct legendre_columns;
+
+/**
+ * @brief Гармоники и множители рекурсии старших степеней в одинарной точности
+ *
+ */
+struct single_harmonics;
+
+/**
+ * @brief Неизменяемая модель гравитационного поля (набор гармоник геопотенциала).
+ * Разделяется между потребителями через gravity_handle и живёт, пока существует хотя бы одна ссылка на неё.
+ *
+ */
+class gravity_model
+{
+	/**
+	 * @brief Наименование модели
+	 */
+	std::string _name;
+	/**
+	 * @brief Владелец памяти, в которой размещены гармоники (массив или отображение файла)
+	 */
+	std::shared_ptr<void const> _storage;
+	/**
+	 * @brief Гармоники, упорядоченные по степени
+	 */
+	potential_harmonic const *_data{};
+	/**
+	 * @brief Старшая степень гармоник
+	 */
+	size_t _degree{};
+
+public:
+	/**
+	 * @brief Создание модели из массива гармоник (гармоники неполной старшей степени отбрасываются).
+	 *
+	 * @param name наименование модели
+	 * @param harmonics гармоники, упорядоченные по степени
+	 */
+	gravity_model(std::string name, std::vector<potential_harmonic> harmonics);
+	/**
+	 * @brief Создание модели из гармоник, размещённых во внешней памяти.
+	 *
+	 * @param name наименование модели
+	 * @param storage владелец памяти
+	 * @param data указатель на гармоники
+	 * @param degree старшая степень гармоник
+	 */
+	gravity_model(std::string name, std::shared_ptr<void const> storage, potential_harmonic const *data, size_t degree);
+
+	/**
+	 * @brief Наименование модели
+	 */
+	std::string const &name() const { return _name; }
+	/**
+	 * @brief Старшая степень гармоник
+	 */
+	size_t degree() const { return _degree; }
+	/**
+	 * @brief Указатель на гармоники
+	 */
+	potential_harmonic const *data() const { return _data; }
+};
+
+/**
+ * @brief Ссылка на неизменяемую модель гравитационного поля
+ *
+ */
+using gravity_handle = std::shared_ptr<gravity_model const>;
+
+/**
+ * @brief Рабочие буферы для вычисления геопотенциала.
+ * Объект не разделяется между потоками: каждый поток использует свой экземпляр, а сам геопотенциал остаётся неизменным.
+ *
+ */
+class gpt_workspace
+{
+	friend class geopotential;
 	/**
 	 * @brief Гармоники синусов и косинусов долготы
 	 */
@@ -88,32 +257,178 @@ class geopotential
 	 * @brief Значения полиномов Лежандра
 	 */
 	std::vector<double> _pnm;
+	/**
+	 * @brief Три столбца полиномов Лежандра (при обходе по столбцам)
+	 */
+	std::vector<double> _cols;
+	/**
+	 * @brief Строки полиномов и гармоники долготы в одинарной точности (при смешанной точности)
+	 */
+	std::vector<float> _float;
+
+public:
+	gpt_workspace() = default;
+	/**
+	 * @brief Выделение буферов под заданную степень разложения.
+	 *
+	 * @param count степень разложения
+	 */
+	explicit gpt_workspace(size_t count);
+	/**
+	 * @brief Увеличение буферов до заданной степени разложения (если они меньше).
+	 * Для обхода по столбцам выделяются только три столбца, а не треугольник полиномов.
+	 *
+	 * @param count степень разложения
+	 * @param engine способ вычисления
+	 */
+	void reserve(size_t count, gpt_engine engine = gpt_engine::spherical);
+};
+
+/**
+ * @brief Гравитационный потенциал Земли.
+ * Объект неизменяем после создания, поэтому один экземпляр может использоваться из нескольких потоков одновременно.
+ * Промежуточные значения хранятся во внешнем gpt_workspace; методы без него используют буферы текущего потока.
+ *
+ */
+class geopotential
+{
+	/**
+	 * @brief Модель гравитационного поля
+	 */
+	gravity_handle _model;
+	/**
+	 * @brief Коэффициенты рекурсии (общие для всех объектов одной степени)
+	 */
+	std::shared_ptr<legendre_coefficients const> _coefs;
+	/**
+	 * @brief Степень разложения
+	 */
+	size_t _count{};
+	/**
+	 * @brief Способ вычисления
+	 */
+	gpt_engine _engine{gpt_engine::spherical};
+	/**
+	 * @brief Допустимая погрешность ускорения от отбрасывания старших степеней [м/с^2] (0 - без отбрасывания)
+	 */
+	double _tolerance{};
+	/**
+	 * @brief Оценки вклада степеней в ускорение (только при ненулевой допустимой погрешности)
+	 */
+	std::shared_ptr<std::vector<double> const> _bounds;
+	/**
+	 * @brief Таблицы для обхода по столбцам (только для gpt_engine::streaming)
+	 */
+	std::shared_ptr<legendre_columns const> _columns;
+	/**
+	 * @brief Степень, выше которой гармоники суммируются в одинарной точности (только для gpt_engine::mixed)
+	 */
+	size_t _single{};
+	/**
+	 * @brief Таблицы в одинарной точности (только для gpt_engine::mixed)
+	 */
+	std::shared_ptr<single_harmonics const> _singles;
 
 private:
-	void move(geopotential &other) noexcept;
+	template <gpt_order order>
+	void evaluate_spherical(double const in[3], gpt_values &out, gpt_workspace &ws) const;
+	template <gpt_order order>
+	void evaluate_cartesian(double const in[3], gpt_values &out, gpt_workspace &ws) const;
+	template <gpt_order order>
+	void evaluate_streaming(double const in[3], gpt_values &out, gpt_workspace &ws) const;
+	template <bool grad>
+	void evaluate_single(size_t first, size_t count, double cosf, double sinf, double _r, double mult, double &u, double du[3], gpt_workspace &ws) const;
 
 public:
 	geopotential();
-	explicit geopotential(size_t count);
+	/**
+	 * @brief Инициализация потенциала по гармоникам, загруженным в egm::harmonics.
+	 * Используемая часть гармоник копируется, поэтому последующая перезагрузка egm::harmonics на объект не влияет.
+	 *
+	 * @param count степень разложения
+	 * @param engine способ вычисления
+	 * @param tolerance допустимая погрешность ускорения [м/с^2], по которой степень разложения уменьшается с высотой (0 - всегда полная степень)
+	 * @param single степень, выше которой гармоники суммируются в одинарной точности (только для gpt_engine::mixed, не меньше 2)
+	 */
+	explicit geopotential(size_t count, gpt_engine engine = gpt_engine::spherical, double tolerance = 0, size_t single = 70);
+	/**
+	 * @brief Инициализация потенциала по модели гравитационного поля.
+	 *
+	 * @param model модель гравитационного поля
+	 * @param count степень разложения (ограничивается степенью модели)
+	 * @param engine способ вычисления
+	 * @param tolerance допустимая погрешность ускорения [м/с^2], по которой степень разложения уменьшается с высотой (0 - всегда полная степень)
+	 * @param single степень, выше которой гармоники суммируются в одинарной точности (только для gpt_engine::mixed, не меньше 2)
+	 */
+	geopotential(gravity_handle model, size_t count, gpt_engine engine = gpt_engine::spherical, double tolerance = 0, size_t single = 70);
 	geopotential(const geopotential &other) = default;
-	geopotential(geopotential &&other) noexcept;
+	geopotential(geopotential &&other) noexcept = default;
 	geopotential &operator=(const geopotential &other) = default;
-	geopotential &operator=(geopotential &&other) noexcept;
+	geopotential &operator=(geopotential &&other) noexcept = default;
 
+	/**
+	 * @brief Степень разложения
+	 */
+	size_t count() const { return _count; }
+	/**
+	 * @brief Способ вычисления
+	 */
+	gpt_engine engine() const { return _engine; }
+	/**
+	 * @brief Модель гравитационного поля
+	 */
+	gravity_handle const &model() const { return _model; }
+	/**
+	 * @brief Степень разложения, используемая на заданном расстоянии от центра.
+	 * Старшие степени отбрасываются, пока сумма оценок их вклада в ускорение не превышает допустимой погрешности.
+	 *
+	 * @param r расстояние от центра Земли [м]
+	 */
+	size_t degree(double r) const;
+	/**
+	 * @brief Вычисление потенциала и его производных за один проход по гармоникам.
+	 *
+	 * @tparam order порядок вычисляемых производных
+	 * @param in вектор в ГСК (x, y, z) [м]
+	 * @param out значения потенциала и производных (заполняются только поля, соответствующие порядку)
+	 * @param ws рабочие буферы вызывающего потока
+	 */
+	template <gpt_order order>
+	void evaluate(double const in[3], gpt_values &out, gpt_workspace &ws) const;
+	/**
+	 * @brief Вычисление потенциала и его производных с буферами текущего потока.
+	 *
+	 * @tparam order порядок вычисляемых производных
+	 * @param in вектор в ГСК (x, y, z) [м]
+	 * @param out значения потенциала и производных
+	 */
+	template <gpt_order order>
+	void evaluate(double const in[3], gpt_values &out) const;
 	/**
 	 * @brief Вычисление значения потенциала
 	 *
 	 * @param v вектор в ГСК (x, y, z) [м]
 	 * @return значение потенциала
 	 */
-	double operator()(const double *v);
+	double operator()(const double *v) const;
 	/**
 	 * @brief Вычисление значения ускорения потенциала
 	 *
 	 * @param in вектор в ГСК (x, y, z) [м]
 	 * @param out вектор (du/dx, du/dy, du/dz)
 	 */
-	void diffbyxyz(const double in[3], double out[3]);
+	void diffbyxyz(const double in[3], double out[3]) const;
+	/**
+	 * @brief Вычисление ускорений потенциала для массива точек, заданного покомпонентно (structure of arrays).
+	 * Точки обрабатываются пакетами (AVX2/FMA, если процессор их поддерживает и библиотека собрана с BALLISTIC_AVX2),
+	 * гармоники читаются один раз на пакет.
+	 * Пакетное вычисление всегда выполняется через сферические координаты, независимо от выбранного способа.
+	 *
+	 * @param count кол-во точек
+	 * @param x, y, z массивы координат в ГСК [м]
+	 * @param ax, ay, az массивы ускорений (du/dx, du/dy, du/dz)
+	 */
+	void diffbyxyz(size_t count, double const *x, double const *y, double const *z, double *ax, double *ay, double *az) const;
 	/**
 	 * @brief Вычисление вектора из производных потенциала и матрицы вторых производных по координатам.
 	 *
@@ -121,9 +436,9 @@ public:
 	 * @param outv вектор производных потенциала (du/dx, du/dy, du/dz)
 	 * @param outm матрица вторых производных ((ddu/ddx, ddu/dxdy, ddu/dxdz), (ddu/dydx, ddu/ddy, ddudydz), (ddu/dzdx, ddu/dzdy, ddu/ddz))
 	 */
-	void ddiffbyxyz(double const in[3], double outv[3], double outm[3][3]);
+	void ddiffbyxyz(double const in[3], double outv[3], double outm[3][3]) const;
 
-	void diffbysph(double const in[3], double out[3]);
+	void diffbysph(double const in[3], double out[3]) const;
 };
 
 /**
@@ -0,0 +1,452 @@
+#pragma once
+#include <integration.hpp>
+#include <maths.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Двоичный формат хранения эфемерид: заголовок chebyshev_header, за которым следуют коэффициенты
+ * по отрезкам, в отрезке - от нулевой степени к старшей, при каждой степени - по компонентам.
+ * Все числа записываются в порядке байт little-endian независимо от платформы.
+ */
+namespace math
+{
+	/**
+	 * @brief Заголовок двоичного файла эфемерид
+	 *
+	 */
+	struct chebyshev_header
+	{
+		/**
+		 * @brief Сигнатура файла
+		 */
+		char magic[8];
+		/**
+		 * @brief Версия формата
+		 */
+		std::uint32_t version;
+		/**
+		 * @brief Кол-во компонент разложений
+		 */
+		std::uint32_t dimension;
+		/**
+		 * @brief Степень полиномов
+		 */
+		std::uint32_t degree;
+		/**
+		 * @brief Кол-во отрезков
+		 */
+		std::uint32_t count;
+		/**
+		 * @brief Начало и конец промежутка, длина отрезка (в единицах времени прогноза)
+		 */
+		double tn, tk, length;
+		/**
+		 * @brief Длительность единицы времени в секундах, если вторая половина вектора вычисляется дифференцированием первой, иначе 0
+		 * (в файлах версии 1 отсутствует)
+		 */
+		double unit;
+	};
+
+	/**
+	 * @brief Запись эфемерид в двоичный файл. May throw runtime_error.
+	 *
+	 * @param path путь к файлу
+	 * @param header заголовок (сигнатура и версия заполняются при записи)
+	 * @param coefs коэффициенты
+	 */
+	void write_chebyshev(std::string_view path, chebyshev_header header, std::span<double const> coefs);
+	/**
+	 * @brief Чтение эфемерид из двоичного файла. May throw runtime_error.
+	 *
+	 * @param path путь к файлу
+	 * @param header заголовок
+	 * @return коэффициенты
+	 */
+	std::vector<double> read_chebyshev(std::string_view path, chebyshev_header &header);
+
+	/**
+	 * @brief Эфемериды в виде кусочных разложений по полиномам Чебышёва на отрезках одинаковой длины.
+	 * Хранятся только коэффициенты, а вектор на момент вычисляется по индексу отрезка и схеме Кленшоу.
+	 * Степень и длина отрезка выбираются по допустимой погрешности так, чтобы коэффициентов было меньше всего.
+	 * Для векторов из положений и скоростей можно хранить разложения только положений, а скорости вычислять
+	 * дифференцированием ряда (объём вдвое меньше).
+	 *
+	 * @tparam V вектор фиксированной размерности (size(), data(), operator[])
+	 * @tparam T тип времени (операторы -(T), +(D), <(T) и преобразование разности в double)
+	 */
+	template <typename V, typename T>
+	class chebyshev_ephemeris
+	{
+		using D = decltype(std::declval<T>() - std::declval<T>());
+
+		T _tn{}, _tk{};
+		/**
+		 * @brief Длина отрезка
+		 */
+		double _length{};
+		/**
+		 * @brief Длительность единицы времени в секундах, если вторая половина вектора - производные первой по времени в секундах
+		 * (хранятся разложения только первой половины), иначе 0
+		 */
+		double _unit{};
+		std::size_t _degree{}, _count{};
+		std::vector<double> _coefs;
+
+	public:
+		/**
+		 * @brief Наименьшая и наибольшая степени полиномов при автоматическом выборе
+		 */
+		constexpr static std::size_t min_degree{7}, max_degree{39};
+
+		chebyshev_ephemeris() = default;
+		/**
+		 * @brief Аппроксимация прогноза с заданной погрешностью.
+		 * Для каждой степени подбирается наименьшее (с точностью до 3%) кол-во отрезков, при котором погрешность
+		 * в промежуточных между узлами точках и на концах отрезков допустима (см. fit).
+		 * Если степень не задана, из степеней min_degree, min_degree + 4, ..., max_degree выбирается та,
+		 * при которой хранится меньше всего коэффициентов (для НОО их кол-во мало меняется уже начиная со степени 11).
+		 * Узлы интерполяции (узлы Чебышёва) округляются до представимых моментов, поэтому коэффициенты
+		 * вычисляются решением системы по фактическим узлам.
+		 *
+		 * @tparam S тип функции с сигнатурой V(*)(T const &) (например, point прогноза)
+		 * @param source функция вычисления вектора
+		 * @param tn начальное значение промежутка
+		 * @param tk конечное значение промежутка (tn < tk)
+		 * @param tolerance допустимая погрешность каждой компоненты (в т.ч. вычисляемых дифференцированием)
+		 * @param unit длительность единицы времени в секундах (например, 1e-3 для мс), если вторая половина вектора -
+		 * производные первой по времени в секундах и вычисляется дифференцированием; 0 - разложения всех компонент
+		 * @param degree степень полиномов (0 - выбирается по погрешности)
+		 */
+		template <typename S>
+		chebyshev_ephemeris(S &&source, T const &tn, T const &tk, double tolerance, double unit = 0, std::size_t degree = 0)
+			: _tn{tn}, _tk{tk}, _unit{unit}, _degree{degree}
+		{
+			if (!(tn < tk))
+				throw_invalid_argument("Промежуток аппроксимации должен быть положительным.");
+			if (!(tolerance > 0))
+				throw_invalid_argument("Допустимая погрешность аппроксимации должна быть положительной.");
+			if (!(unit >= 0) || (unit > 0 && V{}.size() % 2 != 0))
+				throw_invalid_argument("Производные вычисляются для векторов из двух половин с положительной единицей времени.");
+			if (degree > 0)
+			{
+				if (!fit(source, tolerance))
+					throw_invalid_argument("Заданная погрешность аппроксимации недостижима.");
+				return;
+			}
+			// наименьший объём коэффициентов: с ростом степени отрезки удлиняются, но каждый хранит больше коэффициентов
+			std::vector<double> coefs;
+			std::size_t best{}, count{};
+			double length{};
+			for (_degree = min_degree; _degree <= max_degree; _degree += 4)
+			{
+				// с ростом степени отрезков требуется не больше, поэтому поиск начинается с кол-ва для предыдущей степени
+				bool fitted = fit(source, tolerance, _count > 0 ? _count : 1);
+				if (fitted && (coefs.empty() || _coefs.size() < coefs.size()))
+				{
+					coefs.swap(_coefs);
+					best = _degree;
+					count = _count;
+					length = _length;
+				}
+			}
+			if (coefs.empty())
+				throw_invalid_argument("Заданная погрешность аппроксимации недостижима.");
+			_coefs.swap(coefs);
+			_degree = best;
+			_count = count;
+			_length = length;
+		}
+		/**
+		 * @brief Загрузка эфемерид из двоичного файла. May throw runtime_error.
+		 *
+		 * @param path путь к файлу
+		 */
+		static chebyshev_ephemeris load(std::string_view path)
+		{
+			chebyshev_header header;
+			chebyshev_ephemeris out;
+			out._coefs = read_chebyshev(path, header);
+			out._unit = header.unit;
+			if (header.dimension != out.dimension() || (header.unit > 0 && V{}.size() % 2 != 0))
+				throw std::runtime_error("Размерность эфемерид в файле " + std::string{path} + " не соответствует вектору.");
+			out._tn = static_cast<T>(header.tn);
+			out._tk = static_cast<T>(header.tk);
+			out._length = header.length;
+			out._degree = header.degree;
+			out._count = header.count;
+			return out;
+		}
+		/**
+		 * @brief Запись эфемерид в двоичный файл. May throw runtime_error.
+		 *
+		 * @param path путь к файлу
+		 */
+		void save(std::string_view path) const
+		{
+			chebyshev_header header{};
+			header.dimension = static_cast<std::uint32_t>(dimension());
+			header.degree = static_cast<std::uint32_t>(_degree);
+			header.count = static_cast<std::uint32_t>(_count);
+			header.tn = static_cast<double>(_tn);
+			header.tk = static_cast<double>(_tk);
+			header.length = _length;
+			header.unit = _unit;
+			write_chebyshev(path, header, _coefs);
+		}
+		/**
+		 * @brief Кол-во отрезков
+		 */
+		std::size_t count() const { return _count; }
+		/**
+		 * @brief Степень полиномов
+		 */
+		std::size_t degree() const { return _degree; }
+		/**
+		 * @brief Кол-во компонент разложений (половина вектора, если вторая половина вычисляется дифференцированием)
+		 */
+		std::size_t dimension() const { return _unit > 0 ? V{}.size() / 2 : V{}.size(); }
+		/**
+		 * @brief Кол-во хранимых коэффициентов
+		 */
+		std::size_t size() const { return _coefs.size(); }
+		/**
+		 * @brief Возвращает вектор на заданный момент.
+		 *
+		 * @param t момент из промежутка [tn, tk]
+		 */
+		V point(T const &t) const
+		{
+			if (t < _tn || _tk < t)
+				throw_invalid_argument("Момент времени находится за пределами промежутка эфемерид.");
+			double s = static_cast<double>(t - _tn) / _length;
+			std::size_t index = min_of(static_cast<std::size_t>(s), _count - 1);
+			V out;
+			evaluate(_coefs.data() + index * dimension() * (_degree + 1), 2 * (s - index) - 1, out);
+			return out;
+		}
+		/**
+		 * @brief Вычисляет векторы на заданные моменты.
+		 *
+		 * @param times моменты из промежутка [tn, tk]
+		 * @param out векторы (по одному на каждый момент)
+		 */
+		void points(std::span<T const> times, std::span<V> out) const
+		{
+			if (out.size() != times.size())
+				throw_invalid_argument("Кол-во векторов не соответствует кол-ву моментов времени.");
+			for (std::size_t i{}; i < times.size(); ++i)
+				out[i] = point(times[i]);
+		}
+		/**
+		 * @brief Возвращает векторы на заданные моменты.
+		 *
+		 * @param times моменты из промежутка [tn, tk]
+		 */
+		std::vector<V> points(std::span<T const> times) const
+		{
+			std::vector<V> out(times.size());
+			points(times, out);
+			return out;
+		}
+
+	private:
+		/**
+		 * @brief Значения суммы ряда по схеме Кленшоу (для всех компонент одновременно)
+		 * и, если задана единица времени, её производных: b'(k) = 2 * b(k + 1) + 2x * b'(k + 1) - b'(k + 2).
+		 *
+		 * @param coefs коэффициенты отрезка
+		 * @param x аргумент из [-1, 1]
+		 */
+		void evaluate(double const *coefs, double x, V &out) const
+		{
+			constexpr std::size_t size = V{}.size();
+			std::size_t dim = dimension();
+			double b1[size]{}, b2[size]{}, d1[size]{}, d2[size]{};
+			for (std::size_t k{_degree}; k > 0; --k)
+			{
+				double const *c = coefs + k * dim;
+				for (std::size_t i{}; i < dim; ++i)
+				{
+					double b = 2 * x * b1[i] - b2[i] + c[i];
+					double d = 2 * b1[i] + 2 * x * d1[i] - d2[i];
+					b2[i] = b1[i];
+					b1[i] = b;
+					d2[i] = d1[i];
+					d1[i] = d;
+				}
+			}
+			for (std::size_t i{}; i < dim; ++i)
+				out[i] = x * b1[i] - b2[i] + coefs[i];
+			if (_unit > 0)
+			{
+				// производная по аргументу, умноженная на dx/dt = 2 / длина отрезка
+				double scale = 2 / (_length * _unit);
+				for (std::size_t i{}; i < dim; ++i)
+					out[dim + i] = (b1[i] + x * d1[i] - d2[i]) * scale;
+			}
+		}
+
+		/**
+		 * @brief Момент, соответствующий аргументу на отрезке (округлённый до представимого и не выходящий за промежуток).
+		 */
+		T moment(std::size_t index, double x) const
+		{
+			T t = _tn + static_cast<D>(_length * (index + (x + 1) / 2));
+			return _tk < t ? _tk : t;
+		}
+
+		/**
+		 * @brief Аргумент на отрезке, соответствующий моменту.
+		 */
+		double argument(std::size_t index, T const &t) const
+		{
+			return 2 * (static_cast<double>(t - _tn) / _length - index) - 1;
+		}
+
+		/**
+		 * @brief Решение системы a * x = b методом Гаусса с выбором главного элемента по столбцу.
+		 *
+		 * @param a матрица size x size (по строкам), портится
+		 * @param b правые части size x count (по строкам), заменяются решениями
+		 */
+		static void solve(std::vector<double> &a, std::vector<double> &b, std::size_t size, std::size_t count)
+		{
+			for (std::size_t c{}; c < size; ++c)
+			{
+				std::size_t p{c};
+				for (std::size_t r{c + 1}; r < size; ++r)
+				{
+					if (std::abs(a[r * size + c]) > std::abs(a[p * size + c]))
+						p = r;
+				}
+				if (a[p * size + c] == 0)
+					throw_invalid_argument("Вырожденная система узлов аппроксимации.");
+				if (p != c)
+				{
+					std::swap_ranges(a.begin() + p * size, a.begin() + (p + 1) * size, a.begin() + c * size);
+					std::swap_ranges(b.begin() + p * count, b.begin() + (p + 1) * count, b.begin() + c * count);
+				}
+				for (std::size_t r{c + 1}; r < size; ++r)
+				{
+					double m = a[r * size + c] / a[c * size + c];
+					for (std::size_t k{c}; k < size; ++k)
+						a[r * size + k] -= m * a[c * size + k];
+					for (std::size_t k{}; k < count; ++k)
+						b[r * count + k] -= m * b[c * count + k];
+				}
+			}
+			for (std::size_t c{size}; c-- > 0;)
+			{
+				for (std::size_t k{}; k < count; ++k)
+				{
+					double sum = b[c * count + k];
+					for (std::size_t r{c + 1}; r < size; ++r)
+						sum -= a[c * size + r] * b[r * count + k];
+					b[c * count + k] = sum / a[c * size + c];
+				}
+			}
+		}
+
+		/**
+		 * @brief Задание кол-ва отрезков.
+		 *
+		 * @return допустимо ли оно (отрезки не короче степени и покрывают промежуток)
+		 */
+		bool resize(std::size_t count)
+		{
+			double duration = static_cast<double>(_tk - _tn);
+			_count = count;
+			// длина отрезка (для целочисленного времени - округлённая вверх)
+			_length = duration / count;
+			if constexpr (std::is_integral_v<D>)
+				_length = std::ceil(_length);
+			return _length >= _degree + 1 && (count - 1) * _length < duration;
+		}
+
+		/**
+		 * @brief Подбор наименьшего кол-ва отрезков при текущей степени: кол-во удваивается до достижения погрешности,
+		 * затем уточняется делением пополам (погрешность убывает с ростом кол-ва отрезков почти монотонно).
+		 *
+		 * @param hint начальное кол-во отрезков
+		 * @return достигнута ли допустимая погрешность
+		 */
+		template <typename S>
+		bool fit(S &source, double tolerance, std::size_t hint = 1)
+		{
+			std::size_t low{}, high{hint};
+			for (;; low = high, high *= 2)
+			{
+				if (!resize(high))
+					return false;
+				if (approximate(source, tolerance))
+					break;
+			}
+			// кол-во отрезков уточняется до 3%
+			while (high - low > 1 + high / 32)
+			{
+				std::size_t middle = (low + high) / 2;
+				if (resize(middle) && approximate(source, tolerance))
+					high = middle;
+				else
+					low = middle;
+			}
+			resize(high);
+			return approximate(source, tolerance);
+		}
+
+		/**
+		 * @brief Вычисление коэффициентов при текущей длине отрезка.
+		 *
+		 * @return достигнута ли допустимая погрешность
+		 */
+		template <typename S>
+		bool approximate(S &source, double tolerance)
+		{
+			std::size_t dim = dimension(), size = V{}.size(), nodes = _degree + 1;
+			_coefs.assign(_count * dim * nodes, 0);
+			std::vector<double> a(nodes * nodes), b(nodes * dim);
+			for (std::size_t index{}; index < _count; ++index)
+			{
+				// значения полиномов Чебышёва в узлах: T0 = 1, T1 = x, T(k+1) = 2x * Tk - T(k-1)
+				for (std::size_t j{}; j < nodes; ++j)
+				{
+					T t = moment(index, std::cos(pi * (j + 0.5) / nodes));
+					double x = argument(index, t);
+					V value = source(t);
+					double *row = a.data() + j * nodes;
+					row[0] = 1;
+					if (nodes > 1)
+						row[1] = x;
+					for (std::size_t k{2}; k < nodes; ++k)
+						row[k] = 2 * x * row[k - 1] - row[k - 2];
+					for (std::size_t i{}; i < dim; ++i)
+						b[j * dim + i] = value[i];
+				}
+				solve(a, b, nodes, dim);
+				double *coefs = _coefs.data() + index * dim * nodes;
+				std::copy(b.begin(), b.end(), coefs);
+				// проверка в серединах между узлами и на концах отрезка (в т.ч. компонент, вычисляемых дифференцированием)
+				for (std::size_t j{}; j <= nodes; ++j)
+				{
+					T t = moment(index, std::cos(pi * j / nodes));
+					V expected = source(t), actual;
+					evaluate(coefs, argument(index, t), actual);
+					for (std::size_t i{}; i < size; ++i)
+					{
+						if (!(std::abs(actual[i] - expected[i]) <= tolerance))
+							return false;
+					}
+				}
+			}
+			return true;
+		}
+	};
+}
@@ -0,0 +1,286 @@
+#pragma once
+#include <ball.hpp>
+#include <integration.hpp>
+#include <maths.hpp>
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Движение по кеплеровой орбите, заданной вектором состояния.
+ * Уравнение Кеплера решается в универсальной переменной, поэтому вычисление пригодно для любых орбит.
+ *
+ */
+class kepler_motion
+{
+	double _r[3], _v[3];
+	double _mu;
+	/**
+	 * @brief Расстояние, (r * v) / sqrt(mu) и величина, обратная большой полуоси
+	 */
+	double _r0, _sigma, _alpha;
+
+public:
+	kepler_motion() = default;
+	/**
+	 * @brief Опорная орбита по начальному вектору
+	 *
+	 * @param r положение (x, y, z) [м]
+	 * @param v скорость (vx, vy, vz) [м/с]
+	 * @param mu гравитационная постоянная
+	 */
+	kepler_motion(double const r[3], double const v[3], double mu = egm::mu);
+	/**
+	 * @brief Вычисление положения и скорости
+	 *
+	 * @param dt время от момента начального вектора [с]
+	 * @param r положение (x, y, z) [м]
+	 * @param v скорость (vx, vy, vz) [м/с]
+	 */
+	void operator()(double dt, double r[3], double v[3]) const;
+	/**
+	 * @brief Гравитационная постоянная
+	 */
+	double mu() const { return _mu; }
+};
+
+/**
+ * @brief Интегрирование по методу Энке: интегрируется только отклонение от опорной кеплеровой орбиты,
+ * которая вычисляется аналитически. Правая часть уравнения отклонения содержит лишь возмущающие ускорения
+ * и разность центральных ускорений (по Баттину, без потери точности при вычитании близких величин),
+ * поэтому она мала и гладкая, и шаг ограничивается возмущениями, а не центральным полем.
+ * Когда отклонение становится сравнимым с заданной долей расстояния, опорная орбита заменяется
+ * оскулирующей (ректификация), и интегрирование отклонения начинается заново.
+ * Векторы задаются в инерциальной системе координат.
+ *
+ * @tparam T тип времени (как у integrator, а также <(T))
+ * @tparam D тип шага (как у integrator)
+ */
+template <typename T, typename D>
+class encke_integrator
+{
+public:
+	using deviation = math::integrator<math::vec6, T, D>;
+
+	/**
+	 * @brief Участок между ректификациями
+	 */
+	struct arc
+	{
+		/**
+		 * @brief Момент начального вектора опорной орбиты
+		 */
+		T t;
+		kepler_motion reference;
+		/**
+		 * @brief Отклонение от опорной орбиты
+		 */
+		deviation forecast;
+	};
+
+	std::vector<arc> _arcs;
+	/**
+	 * @brief Длительность единицы времени в секундах
+	 */
+	double _unit;
+	/**
+	 * @brief Статистика: вычисления правой части и шаги на всех участках, запросы векторов (собирается при BALLISTIC_STATISTICS)
+	 */
+	mutable math::statistics _stats;
+
+public:
+	/**
+	 * @brief Construct a new encke integrator object
+	 *
+	 * @tparam P тип функции возмущающего ускорения с сигнатурой vec3(*)(vec6 const &, T const &) (без центрального поля)
+	 * @param v исходный вектор в инерциальной системе
+	 * @param tn начальное значение промежутка
+	 * @param tk конечное значение промежутка (tn < tk)
+	 * @param perturbation функция возмущающего ускорения
+	 * @param step шаг интегрирования отклонения (положительный)
+	 * @param unit длительность единицы времени в секундах (например, 1e-3 для мс)
+	 * @param threshold доля расстояния, при превышении которой отклонением выполняется ректификация
+	 * (частые ректификации дороги: после каждой отклонение интегрируется с разгона)
+	 * @param mu гравитационная постоянная центрального поля
+	 */
+	template <typename P>
+	encke_integrator(math::vec6 const &v, T const &tn, T const &tk, P &&perturbation, D const &step,
+					 double unit = 1, double threshold = 3e-2, double mu = egm::mu)
+		: _unit{unit}
+	{
+		if (!(tn < tk) || !(D{} < step))
+			math::throw_invalid_argument("Промежуток и шаг интегрирования должны быть положительными.");
+		// отклонение проверяется через каждые check шагов
+		constexpr std::size_t check{8};
+		math::vec6 state = v;
+		T t = tn;
+		while (true)
+		{
+			kepler_motion reference{state.data(), state.data() + 3, mu};
+			auto func = [this, &perturbation, reference, t](math::vec6 const &d, T const &time)
+			{
+				return deviation_rhs(reference, seconds(time, t), d, time, perturbation);
+			};
+			deviation forecast{math::vec6{}, t, advance(t, tk, step, check), func, step};
+			while (true)
+			{
+				auto const &last = forecast._points.back();
+				if (!(last.t < tk) || !(step < tk - last.t) || large(reference, seconds(last.t, t), last.v, threshold))
+					break;
+				forecast.extend_to(advance(last.t, tk, step, check), func);
+			}
+			auto last = forecast._points.back();
+			_stats += forecast._stats;
+			_arcs.push_back(arc{t, reference, std::move(forecast)});
+			// последний узел не дальше шага от конца промежутка: остаток покрывается последним отрезком
+			if (!(last.t < tk) || !(step < tk - last.t))
+				break;
+			// ректификация: опорная орбита по оскулирующему вектору
+			state = value(last.t);
+			t = last.t;
+		}
+	}
+	/**
+	 * @brief Кол-во ректификаций опорной орбиты
+	 */
+	std::size_t rectifications() const { return _arcs.size() - 1; }
+	/**
+	 * @brief Возвращает вектор на заданный момент (опорная орбита и интерполированное отклонение).
+	 *
+	 * @param t момент
+	 */
+	math::vec6 point(T const &t) const
+	{
+		math::statistics::increase(_stats.queries);
+		return value(t);
+	}
+	/**
+	 * @brief Вычисляет векторы на упорядоченные по возрастанию моменты.
+	 *
+	 * @param times моменты
+	 * @param out векторы (по одному на каждый момент)
+	 */
+	void points(std::span<T const> times, std::span<math::vec6> out) const
+	{
+		if (out.size() != times.size())
+			math::throw_invalid_argument("Кол-во векторов не соответствует кол-ву моментов времени.");
+		math::statistics::increase(_stats.queries, times.size());
+		for (std::size_t begin{}; begin < times.size();)
+		{
+			// моменты на одном участке вычисляются одним обращением к его отклонению
+			std::size_t index = segment(times[begin]);
+			std::size_t end{begin + 1};
+			while (end < times.size() && (index + 1 == _arcs.size() || times[end] < _arcs[index + 1].t))
+				++end;
+			auto const &a = _arcs[index];
+			a.forecast.points(times.subspan(begin, end - begin), out.subspan(begin, end - begin));
+			for (std::size_t i{begin}; i < end; ++i)
+				out[i] += reference(a, times[i]);
+			begin = end;
+		}
+	}
+	/**
+	 * @brief Возвращает векторы на упорядоченные по возрастанию моменты.
+	 *
+	 * @param times моменты
+	 */
+	std::vector<math::vec6> points(std::span<T const> times) const
+	{
+		std::vector<math::vec6> out(times.size());
+		points(times, out);
+		return out;
+	}
+
+private:
+	/**
+	 * @brief Вектор на заданный момент (без учёта в статистике).
+	 */
+	math::vec6 value(T const &t) const
+	{
+		auto const &a = _arcs[segment(t)];
+		return a.forecast.point(t) + reference(a, t);
+	}
+
+	double seconds(T const &t, T const &tn) const
+	{
+		return static_cast<double>(t - tn) * _unit;
+	}
+
+	/**
+	 * @brief Индекс участка, содержащего заданный момент.
+	 */
+	std::size_t segment(T const &t) const
+	{
+		auto it = std::upper_bound(_arcs.begin() + 1, _arcs.end(), t, [](T const &l, arc const &r)
+								   { return l < r.t; });
+		return static_cast<std::size_t>(it - (_arcs.begin() + 1));
+	}
+
+	math::vec6 reference(arc const &a, T const &t) const
+	{
+		math::vec6 out;
+		a.reference(seconds(t, a.t), out.data(), out.data() + 3);
+		return out;
+	}
+
+	/**
+	 * @brief Конец очередной части участка: через count шагов, но не дальше конца промежутка.
+	 */
+	static T advance(T t, T const &tk, D const &step, std::size_t count)
+	{
+		for (std::size_t i{}; i < count && t < tk; ++i)
+			t = t + step;
+		return t < tk ? t : tk;
+	}
+
+	/**
+	 * @brief Превышает ли отклонение заданную долю расстояния.
+	 */
+	static bool large(kepler_motion const &reference, double dt, math::vec6 const &d, double threshold)
+	{
+		double r[3], v[3];
+		reference(dt, r, v);
+		double dr{}, rr{};
+		for (std::size_t i{}; i < 3; ++i)
+		{
+			dr += math::sqr(d[i]);
+			rr += math::sqr(r[i]);
+		}
+		return dr > math::sqr(threshold) * rr;
+	}
+
+	/**
+	 * @brief Производная отклонения: d'' = -mu / p^3 * (d + f(q) * r) + a, где p - опорное положение, r = p + d,
+	 * q = d * (d - 2 * r) / r^2, f(q) = (1 + q)^(3/2) - 1 = q * (3 + 3 * q + q^2) / (1 + (1 + q)^(3/2)).
+	 */
+	template <typename P>
+	static math::vec6 deviation_rhs(kepler_motion const &reference, double dt, math::vec6 const &d, T const &t, P &perturbation)
+	{
+		math::vec6 state;
+		reference(dt, state.data(), state.data() + 3);
+		double pp{};
+		for (std::size_t i{}; i < 3; ++i)
+			pp += math::sqr(state[i]);
+		state += d;
+		double rr{}, dd{};
+		for (std::size_t i{}; i < 3; ++i)
+		{
+			rr += math::sqr(state[i]);
+			dd += d[i] * (d[i] - 2 * state[i]);
+		}
+		double q = dd / rr;
+		double s = std::sqrt(1 + q);
+		double f = q * (3 + q * (3 + q)) / (1 + (1 + q) * s);
+		double m = reference.mu() / (pp * std::sqrt(pp));
+		math::vec3 a = perturbation(state, t);
+		return math::vec6{
+			d[3],
+			d[4],
+			d[5],
+			a[0] - m * (d[0] + f * state[0]),
+			a[1] - m * (d[1] + f * state[1]),
+			a[2] - m * (d[2] + f * state[2]),
+		};
+	}
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <ball.hpp>
+#include <memory>
+#include <mutex>
+
+/**
+ * @brief Кэш ускорения геопотенциала в сферическом слое, заданном интервалом расстояний от центра Земли.
+ * Нецентральная часть ускорения вычисляется в узлах сетки (r, широта, долгота) и интерполируется
+ * трикубическим полиномом Лагранжа; центральная часть mu / r^2 вычисляется точно.
+ * Сетка разбита на блоки по широте и долготе, каждый блок строится при первом обращении (узлы блока - параллельно).
+ * Объект неизменяем с точки зрения пользователя и может использоваться из нескольких потоков и в нескольких прогнозах.
+ *
+ */
+class gpt_field
+{
+	/**
+	 * @brief Блок узлов сетки
+	 */
+	struct tile
+	{
+		std::once_flag flag;
+		/**
+		 * @brief Нецентральная часть ускорения в узлах блока (x, y, z)
+		 */
+		std::vector<double> values;
+	};
+
+	/**
+	 * @brief Потенциал для вычисления значений в узлах и вне слоя
+	 */
+	geopotential _gpt;
+	double _rmin, _rmax;
+	/**
+	 * @brief Допустимая погрешность интерполяции [м/с^2]
+	 */
+	double _tolerance;
+	/**
+	 * @brief Наибольший объём значений в узлах [байт]
+	 */
+	size_t _max_bytes;
+	/**
+	 * @brief Кол-во узлов по расстоянию, широте и долготе
+	 */
+	size_t _nr{}, _nf{}, _nl{};
+	/**
+	 * @brief Шаги сетки по расстоянию [м], широте и долготе [рад]
+	 */
+	double _hr{}, _hf{}, _hl{};
+	/**
+	 * @brief Начальный узел по расстоянию [м]
+	 */
+	double _r0{};
+	/**
+	 * @brief Кол-во блоков по широте и долготе
+	 */
+	size_t _tf{}, _tl{};
+	std::unique_ptr<tile[]> _tiles;
+
+	/**
+	 * @brief Узлы и веса интерполяции для точки
+	 */
+	struct stencil
+	{
+		size_t r, f, l[4];
+		double wr[4], wf[4], wl[4];
+	};
+
+private:
+	void resize(size_t nf);
+	void build_tile(size_t index) const;
+	void prepare(stencil const &s) const;
+	double const *node(size_t ir, size_t jf, size_t jl) const;
+	void compute_node(size_t ir, size_t jf, size_t jl, double out[3]) const;
+	stencil make_stencil(double const in[3], double r) const;
+	template <typename F>
+	void interpolate(double const in[3], double r, stencil const &s, double out[3], F &&node_values) const;
+	double calibrate() const;
+
+public:
+	/**
+	 * @brief Создание кэша. Шаг сетки подбирается так, чтобы погрешность интерполяции в контрольных точках не превышала заданной.
+	 * Объём полностью построенной сетки проверяется до вычисления узлов: начальный шаг определяется степенью разложения,
+	 * и при степени 360 в слое толщиной 200 км сетка занимает около 1.7 ГБ.
+	 * May throw invalid_argument.
+	 *
+	 * @param gpt потенциал (используются его модель и степень разложения)
+	 * @param rmin нижняя граница слоя [м]
+	 * @param rmax верхняя граница слоя [м]
+	 * @param tolerance допустимая погрешность ускорения [м/с^2]
+	 * @param max_bytes наибольший объём значений в узлах полностью построенной сетки [байт]
+	 */
+	gpt_field(geopotential const &gpt, double rmin, double rmax, double tolerance, size_t max_bytes = size_t{1} << 28);
+
+	/**
+	 * @brief Построение всех блоков сетки (параллельно). Необязательно: блоки строятся и при первом обращении.
+	 *
+	 */
+	void build() const;
+	/**
+	 * @brief Вычисление ускорения потенциала. Вне слоя ускорение вычисляется по гармоникам.
+	 *
+	 * @param in вектор в ГСК (x, y, z) [м]
+	 * @param out вектор (du/dx, du/dy, du/dz)
+	 */
+	void diffbyxyz(double const in[3], double out[3]) const;
+
+	/**
+	 * @brief Допустимая погрешность интерполяции [м/с^2]
+	 */
+	double tolerance() const { return _tolerance; }
+	/**
+	 * @brief Кол-во узлов сетки
+	 */
+	size_t size() const { return _nr * _nf * _nl; }
+	/**
+	 * @brief Объём значений в узлах полностью построенной сетки (с неполными блоками) [байт]
+	 */
+	size_t bytes() const;
+	/**
+	 * @brief Потенциал, по которому строится сетка
+	 */
+	geopotential const &gpt() const { return _gpt; }
+};
@@ -0,0 +1,164 @@
+#pragma once
+#include <gptkernel.hpp>
+#include <array>
+#include <stdexcept>
+
+/**
+ * @brief Гравитационный потенциал Земли со степенью разложения, заданной при компиляции.
+ * Множители рекуррентных соотношений вычисляются при компиляции, гармоники копируются в объект,
+ * а рабочие массивы размещаются на стеке, поэтому вычисление не обращается к куче,
+ * а границы циклов известны компилятору (развёртка и векторизация).
+ * Вычисление выполняется в декартовых координатах (по Пайнсу).
+ *
+ * @tparam N степень разложения
+ */
+template <size_t N>
+class geopotential_fixed
+{
+	static constexpr size_t dim = egm::harmonics_count(N);
+
+	static constexpr std::array<legendre_factors, dim + 2> make_factors()
+	{
+		// дополнительные элементы с нулевыми множителями (для степеней 0 и 1)
+		std::array<legendre_factors, dim + 2> factors{};
+		for (size_t n{}, k{}; n <= N; ++n)
+		{
+			for (size_t m{}; m <= n; ++m, ++k)
+			{
+				factors[k] = gpt_detail::make_legendre_factors(n, m);
+			}
+		}
+		return factors;
+	}
+
+	/**
+	 * @brief Множители рекуррентных соотношений
+	 */
+	static constexpr std::array<legendre_factors, dim + 2> _factors = make_factors();
+	/**
+	 * @brief Гармоники геопотенциала
+	 */
+	std::array<potential_harmonic, dim> _harmonics;
+
+private:
+	void assign(potential_harmonic const *data, size_t degree)
+	{
+		if (degree < N)
+		{
+			throw std::runtime_error("Степень загруженных гармоник геопотенциала меньше требуемой.");
+		}
+		std::copy(data, data + dim, _harmonics.begin());
+	}
+
+public:
+	/**
+	 * @brief Инициализация потенциала по гармоникам, загруженным в egm::harmonics. May throw runtime_error.
+	 *
+	 */
+	geopotential_fixed()
+	{
+		if (egm::harmonics.empty())
+		{
+			throw std::runtime_error("Гармоники геопотенциала не загружены.");
+		}
+		assign(egm::harmonics.data(), egm::harmonics_degree(egm::harmonics.size()));
+	}
+	/**
+	 * @brief Инициализация потенциала по модели гравитационного поля. May throw runtime_error.
+	 *
+	 * @param model модель гравитационного поля (степень не меньше N)
+	 */
+	explicit geopotential_fixed(gravity_handle const &model)
+	{
+		if (!model)
+		{
+			throw std::runtime_error("Не задана модель гравитационного поля.");
+		}
+		assign(model->data(), model->degree());
+	}
+
+	/**
+	 * @brief Степень разложения
+	 */
+	static constexpr size_t count() { return N; }
+
+	/**
+	 * @brief Вычисление потенциала и его производных за один проход по гармоникам.
+	 *
+	 * @tparam order порядок вычисляемых производных
+	 * @param in вектор в ГСК (x, y, z) [м]
+	 * @param out значения потенциала и производных (заполняются только поля, соответствующие порядку)
+	 */
+	template <gpt_order order>
+	void evaluate(double const in[3], gpt_values &out) const
+	{
+		std::array<trigonometric_func, N + 1> cs;
+		std::array<double, dim + 2> pnm;
+		gpt_detail::evaluate_pines<order>(in, out, std::integral_constant<size_t, N>{}, _factors.data(), _harmonics.data(), cs.data(), pnm.data());
+	}
+	/**
+	 * @brief Вычисление значения потенциала
+	 *
+	 * @param v вектор в ГСК (x, y, z) [м]
+	 * @return значение потенциала
+	 */
+	double operator()(const double *v) const
+	{
+		gpt_values out;
+		evaluate<gpt_order::value>(v, out);
+		return out.u;
+	}
+	/**
+	 * @brief Вычисление значения ускорения потенциала
+	 *
+	 * @param in вектор в ГСК (x, y, z) [м]
+	 * @param out вектор (du/dx, du/dy, du/dz)
+	 */
+	void diffbyxyz(const double in[3], double out[3]) const
+	{
+		gpt_values values;
+		evaluate<gpt_order::gradient>(in, values);
+		std::memcpy(out, values.du, sizeof(values.du));
+	}
+	/**
+	 * @brief Вычисление ускорений потенциала для массива точек, заданного покомпонентно (structure of arrays).
+	 * Точки обрабатываются пакетами через сферические координаты, гармоники читаются один раз на пакет.
+	 * На процессорах с AVX2/FMA вызывается копия ядра библиотеки, собранная с этими инструкциями (степень передаётся
+	 * при выполнении), иначе - ядро для набора инструкций вызывающей единицы трансляции с рабочими массивами на стеке.
+	 *
+	 * @param count кол-во точек
+	 * @param x, y, z массивы координат в ГСК [м]
+	 * @param ax, ay, az массивы ускорений (du/dx, du/dy, du/dz)
+	 */
+	void diffbyxyz(size_t count, double const *x, double const *y, double const *z, double *ax, double *ay, double *az) const
+	{
+		if (gpt_detail::avx2_supported())
+		{
+			gpt_detail::diffbyxyz_avx2(count, x, y, z, ax, ay, az, _factors.data(), _harmonics.data(), N);
+			return;
+		}
+		using math::simd::dpack;
+		std::array<dpack, N + 1> cs, sn;
+		std::array<dpack, N + 2> prev, curr;
+		gpt_detail::diffbyxyz_packs(count, x, y, z, ax, ay, az,
+									[&](dpack const in[3], dpack out[3], size_t)
+									{
+										gpt_detail::diffbyxyz_pack(in, out, _factors.data(), _harmonics.data(), std::integral_constant<size_t, N>{},
+																   cs.data(), sn.data(), prev.data(), curr.data());
+									});
+	}
+	/**
+	 * @brief Вычисление вектора из производных потенциала и матрицы вторых производных по координатам.
+	 *
+	 * @param in вектор в ГСК (x, y, z) [м]
+	 * @param outv вектор производных потенциала (du/dx, du/dy, du/dz)
+	 * @param outm матрица вторых производных
+	 */
+	void ddiffbyxyz(double const in[3], double outv[3], double outm[3][3]) const
+	{
+		gpt_values values;
+		evaluate<gpt_order::hessian>(in, values);
+		std::memcpy(outv, values.du, sizeof(values.du));
+		std::memcpy(outm, values.ddu, sizeof(values.ddu));
+	}
+};
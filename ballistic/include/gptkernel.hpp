@@ -0,0 +1,708 @@
+#pragma once
+#include <ball.hpp>
+#include <maths.hpp>
+#include <simd.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Множители рекуррентных соотношений для гармоники (n, m)
+ *
+ */
+struct legendre_factors
+{
+	/**
+	 * @brief Множитель при Pn-1,m (для секториальных гармоник - множитель при Pn-1,n-1)
+	 */
+	double a;
+	/**
+	 * @brief Множитель при Pn-2,m
+	 */
+	double b;
+	/**
+	 * @brief Множитель при Pn,m+1 в первой производной по широте
+	 */
+	double d;
+	/**
+	 * @brief Множитель при Pn,m+2 во второй производной по широте
+	 */
+	double e;
+};
+
+/**
+ * @brief Множители рекурсии по степени для элемента столбца порядка m
+ *
+ */
+struct column_factors
+{
+	/**
+	 * @brief Множитель при Pn-1,m (для секториальной гармоники - при Pm-1,m-1)
+	 */
+	double a;
+	/**
+	 * @brief Множитель при Pn-2,m
+	 */
+	double b;
+};
+
+/**
+ * @brief Гармоника геопотенциала вместе с множителями производных, упорядоченная по порядку m
+ *
+ */
+struct column_harmonic
+{
+	double cos, sin;
+	/**
+	 * @brief Множитель при Pn,m+1 в первой производной
+	 */
+	double d;
+	/**
+	 * @brief Множитель при Pn,m+2 во второй производной
+	 */
+	double e;
+};
+
+/**
+ * @brief Гармоники старших степеней в одинарной точности (для gpt_engine::mixed)
+ *
+ */
+struct single_harmonics
+{
+	/**
+	 * @brief Индекс первой гармоники в одинарной точности в таблицах двойной точности
+	 */
+	size_t offset;
+	/**
+	 * @brief Множители производной и гармоники (с дополнением нулями на пакет float)
+	 */
+	std::vector<float> d, cos, sin;
+
+	single_harmonics(potential_harmonic const *h, legendre_factors const *f, size_t single, size_t count);
+};
+
+/**
+ * Общие для geopotential и geopotential_fixed функции вычисления гармоник.
+ * Степень разложения передаётся параметром шаблона C: size_t либо std::integral_constant,
+ * во втором случае границы всех циклов известны компилятору.
+ */
+namespace gpt_detail
+{
+	/**
+	 * @brief Квадратный корень, пригодный для вычисления при компиляции
+	 */
+	constexpr double sqrt(double x)
+	{
+		if (std::is_constant_evaluated())
+		{
+			if (x <= 0)
+			{
+				return 0;
+			}
+			// метод Ньютона, начиная с приближения сверху, пока последовательность убывает
+			double root = x > 1 ? x : 1;
+			while (true)
+			{
+				double next = 0.5 * (root + x / root);
+				if (next >= root)
+				{
+					return root;
+				}
+				root = next;
+			}
+		}
+		return std::sqrt(x);
+	}
+
+	constexpr inline double delta(size_t m) noexcept
+	{
+		return m == 0 ? 0.5 : 1.0;
+	}
+
+	/**
+	 * @brief Множители рекуррентных соотношений для гармоники (n, m)
+	 */
+	constexpr legendre_factors make_legendre_factors(size_t n, size_t m)
+	{
+		legendre_factors f{};
+		if (n == 0)
+		{
+			// P00 = 1 задаётся явно
+			return f;
+		}
+		if (n == 1)
+		{
+			f.a = sqrt(3.);
+		}
+		else if (m == n)
+		{
+			f.a = sqrt(1 + 0.5 / n);
+		}
+		else
+		{
+			double nm = double(n - m) * (n + m);
+			f.a = sqrt((2. * n - 1) * (2. * n + 1) / nm);
+			f.b = sqrt((2. * n + 1) * (n - 1 - m) * (n - 1 + m) / ((2. * n - 3) * nm));
+		}
+		if (m < n)
+		{
+			f.d = sqrt(delta(m) * (n + m + 1) * (n - m));
+			if (m + 1 < n)
+			{
+				f.e = f.d * sqrt(double(n + m + 2) * (n - m - 1));
+			}
+		}
+		return f;
+	}
+
+	/**
+	 * @brief Вычисление гармоник синусов и косинусов долготы.
+	 */
+	template <typename C>
+	inline void calc_trigonometric(double cos, double sin, trigonometric_func *cs, C count)
+	{
+		cs[0].cos = 1;
+		cs[0].sin = 0;
+		for (size_t i{1}; i <= count; ++i)
+		{
+			cs[i].cos = cs[i - 1].cos * cos - cs[i - 1].sin * sin;
+			cs[i].sin = cs[i - 1].sin * cos + cs[i - 1].cos * sin;
+		}
+	}
+
+	/**
+	 * @brief Вычисление значений полиномов Лежандра.
+	 */
+	template <typename C>
+	inline void calc_polynomials(double cos, double sin, double *pnm, legendre_factors const *f, C count)
+	{
+		pnm[0] = 1;
+		pnm[1] = sin * f[1].a;
+		pnm[2] = cos * f[2].a;
+		for (size_t n{2}, k{3}; n <= count; ++n)
+		{
+			for (size_t m{}; m < n; ++m, ++k)
+			{
+				pnm[k] = f[k].a * sin * pnm[k - n] - f[k].b * pnm[(k + 1) - n - n];
+			}
+			pnm[k] = f[k].a * cos * pnm[k - n - 1];
+			++k;
+		}
+		// за треугольником - нули (к ним обращаются производные старших гармоник)
+		size_t dim = egm::harmonics_count(count);
+		pnm[dim] = pnm[dim + 1] = 0;
+	}
+
+	/**
+	 * @brief Переход от сумм по Пайнсу к потенциалу и его производным по x, y, z.
+	 *
+	 * @param e направляющие косинусы радиуса-вектора
+	 * @param _r величина, обратная расстоянию от центра
+	 * @param g0, g1, g2 sum{n} (R / r)^n * G_n с множителями 1, (n + 1), (n + 1) * (n + 2)
+	 * @param dg0, dg1 sum{n} (R / r)^n * dG_n с множителями 1, (n + 1)
+	 * @param ddg sum{n} (R / r)^n * ddG_n
+	 */
+	template <gpt_order order>
+	void pines_values(math::vec3 const &e, double _r, double g0, double g1, double g2,
+					  math::vec3 const &dg0, math::vec3 const &dg1, math::mat3x3 const &ddg, gpt_values &out)
+	{
+		using math::mat3x3;
+		using math::vec3;
+		double mu_r{egm::mu * _r};
+		out.u = g0 * mu_r;
+		if constexpr (order >= gpt_order::gradient)
+		{
+			// проекция на плоскость, ортогональную радиусу-вектору
+			mat3x3 proj;
+			for (size_t i{}; i < 3; ++i)
+			{
+				for (size_t j{}; j < 3; ++j)
+				{
+					proj[i][j] = double(i == j) - e[i] * e[j];
+				}
+			}
+			double mu_r2 = mu_r * _r;
+			vec3 du = (proj * dg0 - e * g1) * mu_r2;
+			std::memcpy(out.du, du.data(), sizeof(du));
+			if constexpr (order >= gpt_order::hessian)
+			{
+				vec3 q = proj * (dg0 + dg1);
+				mat3x3 ddu = proj * ddg * proj - proj * (g1 + e * dg0);
+				for (size_t i{}; i < 3; ++i)
+				{
+					for (size_t j{}; j < 3; ++j)
+					{
+						ddu[i][j] += g2 * e[i] * e[j] - q[i] * e[j] - e[i] * q[j];
+					}
+				}
+				ddu *= mu_r2 * _r;
+				std::memcpy(out.ddu, ddu.data(), sizeof(ddu));
+			}
+		}
+	}
+
+	/**
+	 * @brief Вычисление потенциала и его производных в декартовых координатах (по Пайнсу).
+	 *
+	 * Потенциал записывается через направляющие косинусы s = x / r, t = y / r, u = z / r:
+	 * U = sum{n} mu / r * (R / r)^n * G_n(s, t, u), G_n = sum{m} Anm(u) * (Cnm * Em + Snm * Fm),
+	 * где Anm(u) = Pnm(u) / cos^m(f) - нормированные производные полиномов Лежандра (полиномы Гельмгольца),
+	 * Em + i * Fm = (s + i * t)^m. Ни одна из функций не имеет особенностей на полюсах.
+	 * Производные G_n по s, t, u вычисляются в том же проходе, а переход к x, y, z выполняется
+	 * через проектор P = E - s * s^T на плоскость, ортогональную радиусу-вектору.
+	 *
+	 * @param count степень разложения (size_t либо std::integral_constant для степени, известной при компиляции)
+	 * @param f множители рекуррентных соотношений
+	 * @param h гармоники геопотенциала
+	 * @param cs, pnm рабочие буферы (count + 1 и harmonics_count(count) + 2 элементов)
+	 */
+	template <gpt_order order, typename C>
+	void evaluate_pines(double const in[3], gpt_values &out, C count, legendre_factors const *f, potential_harmonic const *h,
+						trigonometric_func *cs, double *pnm)
+	{
+		using math::mat3x3;
+		using math::sqr;
+		using math::vec3;
+		constexpr bool grad = order >= gpt_order::gradient;
+		constexpr bool hess = order >= gpt_order::hessian;
+		double r = std::sqrt(sqr(in[0]) + sqr(in[1]) + sqr(in[2]));
+		double _r{1 / r};
+		// направляющие косинусы
+		const vec3 e{in[0] * _r, in[1] * _r, in[2] * _r};
+		double R_r{egm::rad * _r};
+		double mult{1};
+		// sum{n} (R / r)^n * G_n, sum{n} (R / r)^n * (n + 1) * G_n, sum{n} (R / r)^n * (n + 1) * (n + 2) * G_n
+		double g0{}, g1{}, g2{};
+		// sum{n} (R / r)^n * dG_n, sum{n} (R / r)^n * (n + 1) * dG_n
+		vec3 dg0, dg1;
+		// sum{n} (R / r)^n * ddG_n
+		mat3x3 ddg;
+
+		calc_trigonometric(e[0], e[1], cs, count);
+		calc_polynomials(1, e[2], pnm, f, count);
+
+		for (size_t n{}, k{}; n <= count; ++n)
+		{
+			double g{};
+			double gs{}, gt{}, gu{};
+			double gss{}, gst{}, gsu{}, gtu{}, guu{};
+			// зональная гармоника (m = 0)
+			{
+				double l0 = h[k].cos;
+				g += pnm[k] * l0;
+				if constexpr (grad)
+				{
+					gu += f[k].d * pnm[k + 1] * l0;
+					if constexpr (hess)
+					{
+						guu += f[k].e * pnm[k + 2] * l0;
+					}
+				}
+				++k;
+			}
+			for (size_t m{1}; m <= n; ++m, ++k)
+			{
+				double cnm = h[k].cos;
+				double snm = h[k].sin;
+				double anm = pnm[k];
+				// Cnm * Em + Snm * Fm
+				double l0 = cnm * cs[m].cos + snm * cs[m].sin;
+				g += anm * l0;
+				if constexpr (grad)
+				{
+					// dAnm/du = d * An,m+1
+					double danm = f[k].d * pnm[k + 1];
+					// Cnm * Em-1 + Snm * Fm-1, Snm * Em-1 - Cnm * Fm-1
+					double l1 = cnm * cs[m - 1].cos + snm * cs[m - 1].sin;
+					double k1 = snm * cs[m - 1].cos - cnm * cs[m - 1].sin;
+					gu += danm * l0;
+					gs += m * anm * l1;
+					gt += m * anm * k1;
+					if constexpr (hess)
+					{
+						// ddAnm/ddu = e * An,m+2
+						guu += f[k].e * pnm[k + 2] * l0;
+						gsu += m * danm * l1;
+						gtu += m * danm * k1;
+						// для m = 1 слагаемые равны нулю (множитель m - 1), индекс m - 2 заменяется на 0
+						size_t i = m - (m > 1) - 1;
+						double l2 = cnm * cs[i].cos + snm * cs[i].sin;
+						double k2 = snm * cs[i].cos - cnm * cs[i].sin;
+						gss += m * (m - 1) * anm * l2;
+						gst += m * (m - 1) * anm * k2;
+					}
+				}
+			}
+			g0 += mult * g;
+			if constexpr (grad)
+			{
+				double mult1 = mult * (n + 1);
+				g1 += mult1 * g;
+				vec3 dg{gs, gt, gu};
+				dg0 += dg * mult;
+				dg1 += dg * mult1;
+				if constexpr (hess)
+				{
+					g2 += mult1 * (n + 2) * g;
+					// вторые производные по s и t гармонические: Gtt = -Gss
+					ddg += mat3x3{{gss, gst, gsu}, {gst, -gss, gtu}, {gsu, gtu, guu}} * mult;
+				}
+			}
+			mult *= R_r;
+		}
+		pines_values<order>(e, _r, g0, g1, g2, dg0, dg1, ddg, out);
+	}
+
+	/**
+	 * @brief Индекс начала столбца порядка m в таблицах, упорядоченных по порядку (m-major).
+	 *
+	 * @param m порядок
+	 * @param total степень, до которой построены таблицы
+	 */
+	constexpr size_t column_offset(size_t m, size_t total) noexcept
+	{
+		return m * (2 * total + 3 - m) / 2;
+	}
+
+	/**
+	 * @brief Вычисление потенциала и его производных по Пайнсу обходом по столбцам порядка m.
+	 *
+	 * Полиномы Anm вычисляются рекурсией по степени n внутри столбца уже умноженными на (R / r)^n
+	 * и сразу суммируются с гармониками (суммы по n для каждого m накапливаются отдельно
+	 * и умножаются на Em, Fm, вычисляемые рекурсией по m).
+	 * Производные по u требуют столбцов m + 1 и m + 2, поэтому суммирование отстаёт от рекурсии на один
+	 * (градиент) или два (гессиан) столбца, и в памяти хранятся только три столбца, а не весь треугольник.
+	 * Каждая гармоника и каждый множитель читаются из памяти ровно один раз и последовательно.
+	 *
+	 * @param count используемая степень разложения
+	 * @param total степень, до которой построены таблицы
+	 * @param f множители рекурсии, упорядоченные по порядку
+	 * @param h гармоники, упорядоченные по порядку
+	 * @param cols рабочий буфер (3 * (count + 1) элементов)
+	 */
+	template <gpt_order order>
+	void evaluate_streaming(double const in[3], gpt_values &out, size_t count, size_t total,
+							column_factors const *f, column_harmonic const *h, double *cols)
+	{
+		using math::mat3x3;
+		using math::sqr;
+		using math::vec3;
+		constexpr bool grad = order >= gpt_order::gradient;
+		constexpr bool hess = order >= gpt_order::hessian;
+		// отставание суммирования от рекурсии (в столбцах)
+		constexpr size_t lag = hess ? 2 : grad ? 1 : 0;
+		double r = std::sqrt(sqr(in[0]) + sqr(in[1]) + sqr(in[2]));
+		double _r{1 / r};
+		const vec3 e{in[0] * _r, in[1] * _r, in[2] * _r};
+		double u = e[2];
+		double R_r{egm::rad * _r};
+		// множители рекурсии для (R / r)^n * Anm
+		double uR_r{u * R_r}, R_r2{R_r * R_r};
+		size_t size = count + 1;
+		double g0{}, g1{}, g2{};
+		vec3 dg0, dg1;
+		mat3x3 ddg;
+		// (R / r)^m * Amm для столбца, вычисляемого рекурсией
+		double sect{1};
+		// Em, Fm для суммируемого столбца и Em-1, Fm-1, Em-2, Fm-2
+		double em{1}, fm{}, em1{}, fm1{}, em2{}, fm2{};
+
+		for (size_t j{}; j <= count + lag; ++j)
+		{
+			double *col = cols + (j % 3) * size;
+			// столбец порядка j вычисляется, пока не превышена степень разложения, иначе он нулевой
+			bool recur = j <= count;
+			auto const *fj = f + column_offset(std::min(j, count), total);
+			double prev2{}, prev1{};
+			if (recur)
+			{
+				if (j > 0)
+				{
+					sect *= fj[0].a * R_r;
+				}
+				// элементы ниже секториального нулевые (к ним обращаются производные)
+				for (size_t n{j >= 2 ? j - 2 : 0}; n < j; ++n)
+				{
+					col[n] = 0;
+				}
+				col[j] = prev1 = sect;
+			}
+			else
+			{
+				std::fill(col, col + size, 0.0);
+			}
+			// шаг рекурсии по степени для столбца j
+			auto step = [&](size_t n)
+			{
+				double curr = fj[n - j].a * uR_r * prev1 - fj[n - j].b * R_r2 * prev2;
+				col[n] = curr;
+				prev2 = prev1;
+				prev1 = curr;
+			};
+			if (j < lag)
+			{
+				for (size_t n{j + 1}; n <= count; ++n)
+				{
+					step(n);
+				}
+				continue;
+			}
+			size_t m = j - lag;
+			double const *am = cols + (m % 3) * size;
+			double const *am1 = cols + ((m + 1) % 3) * size;
+			double const *am2 = cols + ((m + 2) % 3) * size;
+			auto const *hm = h + column_offset(m, total) - m;
+			// sum{n} (R / r)^n * Anm * (Cnm, Snm) с множителями 1, (n + 1), (n + 1) * (n + 2)
+			double a0c{}, a0s{}, a1c{}, a1s{}, a2c{}, a2s{};
+			// sum{n} (R / r)^n * dAnm/du * (Cnm, Snm) с множителями 1, (n + 1)
+			double d0c{}, d0s{}, d1c{}, d1s{};
+			// sum{n} (R / r)^n * ddAnm/ddu * (Cnm, Snm)
+			double e0c{}, e0s{};
+			auto term = [&](size_t n)
+			{
+				double w1 = double(n + 1);
+				double anm = am[n];
+				double pc = anm * hm[n].cos, ps = anm * hm[n].sin;
+				a0c += pc;
+				a0s += ps;
+				if constexpr (grad)
+				{
+					double danm = hm[n].d * am1[n];
+					double dc = danm * hm[n].cos, ds = danm * hm[n].sin;
+					a1c += w1 * pc;
+					a1s += w1 * ps;
+					d0c += dc;
+					d0s += ds;
+					d1c += w1 * dc;
+					d1s += w1 * ds;
+					if constexpr (hess)
+					{
+						double w2 = w1 * (w1 + 1);
+						double ddanm = hm[n].e * am2[n];
+						a2c += w2 * pc;
+						a2s += w2 * ps;
+						e0c += ddanm * hm[n].cos;
+						e0s += ddanm * hm[n].sin;
+					}
+				}
+			};
+			// рекурсия по столбцу j совмещена с суммированием по столбцу m: они независимы и выполняются параллельно
+			size_t n{m};
+			for (; n <= std::min(j, count); ++n)
+			{
+				term(n);
+			}
+			if (recur)
+			{
+				for (; n <= count; ++n)
+				{
+					step(n);
+					term(n);
+				}
+			}
+			g0 += a0c * em + a0s * fm;
+			if constexpr (grad)
+			{
+				g1 += a1c * em + a1s * fm;
+				// Cnm * Em-1 + Snm * Fm-1 и Snm * Em-1 - Cnm * Fm-1 (для m = 0 умножаются на m = 0)
+				dg0 += vec3{m * (a0c * em1 + a0s * fm1), m * (a0s * em1 - a0c * fm1), d0c * em + d0s * fm};
+				dg1 += vec3{m * (a1c * em1 + a1s * fm1), m * (a1s * em1 - a1c * fm1), d1c * em + d1s * fm};
+				if constexpr (hess)
+				{
+					g2 += a2c * em + a2s * fm;
+					double mm = double(m) * (m - (m > 0));
+					double gss = mm * (a0c * em2 + a0s * fm2), gst = mm * (a0s * em2 - a0c * fm2);
+					double gsu = m * (d0c * em1 + d0s * fm1), gtu = m * (d0s * em1 - d0c * fm1);
+					double guu = e0c * em + e0s * fm;
+					ddg += mat3x3{{gss, gst, gsu}, {gst, -gss, gtu}, {gsu, gtu, guu}};
+				}
+			}
+			// Em+1 + i * Fm+1 = (Em + i * Fm) * (s + i * t)
+			em2 = em1;
+			fm2 = fm1;
+			em1 = em;
+			fm1 = fm;
+			em = em1 * e[0] - fm1 * e[1];
+			fm = fm1 * e[0] + em1 * e[1];
+		}
+		pines_values<order>(e, _r, g0, g1, g2, dg0, dg1, ddg, out);
+	}
+
+	/**
+	 * @brief Вычисление ускорений для пакета из dpack::size точек.
+	 *
+	 * Полиномы Лежандра вычисляются построчно (по степени n) и сразу суммируются с гармониками,
+	 * поэтому хранятся только две последние строки треугольника, а каждая гармоника читается из памяти один раз на пакет.
+	 *
+	 * @param count степень разложения (size_t либо std::integral_constant)
+	 * @param cs, sn, prev, curr рабочие буферы (count + 1, count + 1, count + 2 и count + 2 элементов)
+	 */
+	template <typename C>
+	void diffbyxyz_pack(math::simd::dpack const in[3], math::simd::dpack out[3],
+						legendre_factors const *f, potential_harmonic const *h, C count,
+						math::simd::dpack *cs, math::simd::dpack *sn, math::simd::dpack *prev, math::simd::dpack *curr)
+	{
+		using math::simd::dpack;
+		dpack const one = dpack::broadcast(1);
+		dpack const zero = dpack::broadcast(0);
+		dpack x = in[0], y = in[1], z = in[2];
+		dpack xy = sqrt(x * x + y * y);
+		dpack r = sqrt(fma(xy, xy, z * z));
+		dpack _r = one / r;
+		dpack sinf = z * _r, cosf = xy * _r, tanf = sinf / cosf;
+		dpack _xy = one / xy;
+		dpack cosl = x * _xy, sinl = y * _xy;
+		dpack R_r = dpack::broadcast(egm::rad) * _r;
+		dpack mult = one;
+		dpack du[3]{zero, zero, zero};
+		// гармоники долготы
+		cs[0] = one;
+		sn[0] = zero;
+		for (size_t m{1}; m <= count; ++m)
+		{
+			cs[m] = fnma(sn[m - 1], sinl, cs[m - 1] * cosl);
+			sn[m] = fma(cs[m - 1], sinl, sn[m - 1] * cosl);
+		}
+		for (size_t i{}; i < count + 2; ++i)
+		{
+			prev[i] = curr[i] = zero;
+		}
+		for (size_t n{}, k{}; n <= count; ++n)
+		{
+			// curr содержит строку n - 2 и заполняется строкой n, prev - строка n - 1
+			if (n == 0)
+			{
+				curr[0] = one;
+			}
+			else if (n == 1)
+			{
+				curr[0] = dpack::broadcast(f[k].a) * sinf;
+				curr[1] = dpack::broadcast(f[k + 1].a) * cosf;
+			}
+			else
+			{
+				for (size_t m{}; m < n; ++m)
+				{
+					curr[m] = fnma(dpack::broadcast(f[k + m].b), curr[m], dpack::broadcast(f[k + m].a) * sinf * prev[m]);
+				}
+				curr[n] = dpack::broadcast(f[k + n].a) * cosf * prev[n - 1];
+			}
+			dpack dudr = zero, dudf = zero, dudl = zero;
+			for (size_t m{}; m <= n; ++m, ++k)
+			{
+				dpack cnm = dpack::broadcast(h[k].cos);
+				dpack snm = dpack::broadcast(h[k].sin);
+				dpack mm = dpack::broadcast(double(m));
+				dpack poly = curr[m];
+				// Cnm * cos(ml) + Snm * sin(ml)
+				dpack kcs = fma(cnm, cs[m], snm * sn[m]);
+				// Snm * cos(ml) - Cnm * sin(ml)
+				dpack ksc = fnma(cnm, sn[m], snm * cs[m]);
+				// производная полинома по широте
+				dpack dpoly = fnma(mm * tanf, poly, dpack::broadcast(f[k].d) * curr[m + 1]);
+				dudr = fma(poly, kcs, dudr);
+				dudf = fma(dpoly, kcs, dudf);
+				dudl = fma(poly * ksc, mm, dudl);
+			}
+			du[0] = fnma(dpack::broadcast(double(n + 1)) * mult, dudr, du[0]);
+			du[1] = fma(mult, dudf, du[1]);
+			du[2] = fma(mult, dudl, du[2]);
+			mult = mult * R_r;
+			std::swap(prev, curr);
+		}
+		dpack mu_r2 = dpack::broadcast(egm::mu) * _r * _r;
+		du[0] = du[0] * mu_r2;
+		du[1] = du[1] * mu_r2;
+		du[2] = du[2] * mu_r2 / cosf;
+		out[0] = fnma(sinl, du[2], cosf * cosl * du[0] - sinf * cosl * du[1]);
+		out[1] = fma(cosl, du[2], cosf * sinl * du[0] - sinf * sinl * du[1]);
+		out[2] = fma(cosf, du[1], sinf * du[0]);
+	}
+
+	/**
+	 * @brief Обход массивов точек пакетами по dpack::size точек.
+	 * Неполный последний пакет дополняется последней точкой.
+	 *
+	 * @param count кол-во точек
+	 * @param x, y, z координаты точек
+	 * @param ax, ay, az вычисленные значения
+	 * @param func вычисление для пакета: func(dpack const in[3], dpack out[3], size_t index первой точки)
+	 */
+	template <typename F>
+	void diffbyxyz_packs(size_t count, double const *x, double const *y, double const *z, double *ax, double *ay, double *az, F &&func)
+	{
+		using math::simd::dpack;
+		constexpr size_t lanes = dpack::size;
+		dpack in[3], out[3];
+		for (size_t i{}; i < count; i += lanes)
+		{
+			if (i + lanes <= count)
+			{
+				in[0] = dpack::load(x + i);
+				in[1] = dpack::load(y + i);
+				in[2] = dpack::load(z + i);
+				func(in, out, i);
+				out[0].store(ax + i);
+				out[1].store(ay + i);
+				out[2].store(az + i);
+			}
+			else
+			{
+				double tmp[3][lanes], res[3][lanes];
+				for (size_t j{}; j < lanes; ++j)
+				{
+					size_t index = i + j < count ? i + j : count - 1;
+					tmp[0][j] = x[index];
+					tmp[1][j] = y[index];
+					tmp[2][j] = z[index];
+				}
+				for (size_t c{}; c < 3; ++c)
+				{
+					in[c] = dpack::load(tmp[c]);
+				}
+				func(in, out, i);
+				for (size_t c{}; c < 3; ++c)
+				{
+					out[c].store(res[c]);
+				}
+				for (size_t j{}; i + j < count; ++j)
+				{
+					ax[i + j] = res[0][j];
+					ay[i + j] = res[1][j];
+					az[i + j] = res[2][j];
+				}
+			}
+		}
+	}
+
+	/**
+	 * Копии пакетных ядер для AVX2/FMA (gptavx2.cpp) выбираются при выполнении по набору инструкций процессора,
+	 * поэтому библиотека и её потребители собираются для базового набора инструкций.
+	 */
+
+	/**
+	 * @brief Собраны ли копии ядер с AVX2/FMA (опция BALLISTIC_AVX2)
+	 */
+	extern bool const avx2_clones;
+	/**
+	 * @brief Собраны ли копии ядер с AVX2/FMA и поддерживает ли процессор эти инструкции (проверяется один раз)
+	 */
+	bool avx2_supported();
+	/**
+	 * @brief Степень разложения для пакета точек по наименьшему расстоянию до центра r
+	 */
+	using pack_degree = size_t (*)(void const *context, double r);
+	/**
+	 * @brief Вычисление ускорений для массива точек пакетами AVX2/FMA (вызывается, только если avx2_supported()).
+	 *
+	 * @param count кол-во точек
+	 * @param degree степень разложения (если степень пакета не задана функцией adapt)
+	 * @param adapt степень разложения для пакета (nullptr - всегда degree, не больше degree)
+	 * @param context аргумент функции adapt
+	 */
+	void diffbyxyz_avx2(size_t count, double const *x, double const *y, double const *z, double *ax, double *ay, double *az,
+						legendre_factors const *f, potential_harmonic const *h, size_t degree,
+						pack_degree adapt = nullptr, void const *context = nullptr);
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <ball.hpp>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string_view>
+
+/**
+ * Двоичный формат хранения гармоник геопотенциала:
+ * заголовок harmonics_header, за которым следуют пары (cos, sin) в порядке (0, 0), (1, 0), (1, 1), (2, 0), ...
+ * Гармоники до степени n занимают непрерывный начальный участок файла, поэтому для разложения
+ * невысокой степени достаточно отобразить в память только его. Числа записываются в порядке байт платформы.
+ */
+namespace egm
+{
+	/**
+	 * @brief Заголовок двоичного файла гармоник
+	 *
+	 */
+	struct harmonics_header
+	{
+		/**
+		 * @brief Сигнатура файла
+		 */
+		char magic[8];
+		/**
+		 * @brief Версия формата
+		 */
+		std::uint32_t version;
+		/**
+		 * @brief Старшая степень гармоник в файле
+		 */
+		std::uint32_t degree;
+	};
+
+	/**
+	 * @brief Преобразование текстового файла гармоник (пары cos sin в строке) в двоичный формат.
+	 * Если кол-во гармоник не соответствует целой степени, лишние гармоники отбрасываются.
+	 *
+	 * @param textpath путь к текстовому файлу
+	 * @param binpath путь к создаваемому двоичному файлу
+	 * @return старшая степень записанных гармоник
+	 */
+	size_t convert_harmonics(std::string_view textpath, std::string_view binpath);
+
+	/**
+	 * @brief Отображение в память начального участка двоичного файла гармоник.
+	 * Отображаются только гармоники до запрошенной степени; страницы загружаются системой при первом обращении.
+	 *
+	 */
+	class mapped_harmonics
+	{
+		void *_handle{};
+		void *_view{};
+		size_t _length{};
+		size_t _degree{};
+
+	private:
+		void close() noexcept;
+
+	public:
+		mapped_harmonics() = default;
+		/**
+		 * @brief Отображение файла. May throw runtime_error.
+		 *
+		 * @param path путь к двоичному файлу
+		 * @param degree старшая степень (ограничивается степенью, записанной в файле)
+		 */
+		mapped_harmonics(std::string_view path, size_t degree);
+		mapped_harmonics(mapped_harmonics const &) = delete;
+		mapped_harmonics(mapped_harmonics &&other) noexcept;
+		mapped_harmonics &operator=(mapped_harmonics const &) = delete;
+		mapped_harmonics &operator=(mapped_harmonics &&other) noexcept;
+		~mapped_harmonics();
+
+		/**
+		 * @brief Указатель на гармоники
+		 */
+		potential_harmonic const *data() const;
+		/**
+		 * @brief Старшая степень отображённых гармоник
+		 */
+		size_t degree() const { return _degree; }
+		/**
+		 * @brief Кол-во отображённых гармоник
+		 */
+		size_t size() const { return harmonics_count(_degree); }
+	};
+
+	/**
+	 * @brief Проверка, является ли файл двоичным файлом гармоник (по сигнатуре).
+	 *
+	 * @param path путь к файлу
+	 */
+	bool is_binary_harmonics(std::string_view path);
+
+	/**
+	 * @brief Загрузка гармоник до заданной степени в egm::harmonics. May throw runtime_error.
+	 * Двоичный файл отображается в память только на нужную длину, текстовый читается до нужной степени.
+	 *
+	 * @param path путь к двоичному или текстовому файлу
+	 * @param degree старшая степень
+	 */
+	void load_harmonics(std::string_view path, size_t degree = egm::count);
+
+	/**
+	 * @brief Загрузка модели гравитационного поля из файла. May throw runtime_error.
+	 * Гармоники двоичного файла не копируются: модель ссылается на отображение файла в память.
+	 *
+	 * @param name наименование модели
+	 * @param path путь к двоичному или текстовому файлу
+	 * @param degree старшая степень
+	 */
+	gravity_handle load_model(std::string name, std::string_view path, size_t degree = egm::count);
+
+	/**
+	 * @brief Реестр именованных моделей гравитационного поля.
+	 * Модели неизменяемы, поэтому выданные ссылки остаются действительными и после замены или удаления модели из реестра.
+	 * Все методы потокобезопасны.
+	 *
+	 */
+	class gravity_registry
+	{
+		mutable std::mutex _sync;
+		std::map<std::string, gravity_handle, std::less<>> _models;
+
+	public:
+		/**
+		 * @brief Загрузка модели из файла и добавление её в реестр (с заменой одноимённой модели).
+		 *
+		 * @param name наименование модели
+		 * @param path путь к двоичному или текстовому файлу
+		 * @param degree старшая степень
+		 * @return ссылка на загруженную модель
+		 */
+		gravity_handle load(std::string const &name, std::string_view path, size_t degree = egm::count);
+		/**
+		 * @brief Добавление модели в реестр (с заменой одноимённой модели).
+		 *
+		 * @param model модель
+		 */
+		void insert(gravity_handle model);
+		/**
+		 * @brief Ссылка на модель. May throw runtime_error, если модели нет в реестре.
+		 *
+		 * @param name наименование модели
+		 */
+		gravity_handle get(std::string_view name) const;
+		/**
+		 * @brief Проверка наличия модели в реестре.
+		 *
+		 * @param name наименование модели
+		 */
+		bool contains(std::string_view name) const;
+		/**
+		 * @brief Удаление модели из реестра.
+		 *
+		 * @param name наименование модели
+		 */
+		void remove(std::string_view name);
+
+		/**
+		 * @brief Общий реестр процесса
+		 */
+		static gravity_registry &global();
+	};
+}
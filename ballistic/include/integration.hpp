@@ -1,4 +1,11 @@
 #pragma once
+#include <statistics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <optional>
+#include <parallel.hpp>
+#include <span>
 #include <vector>
 
 namespace math
@@ -10,6 +17,231 @@ namespace math
 
 	void throw_invalid_argument(char const *);
 
+	/**
+	 * @brief Интерполяция полиномом Лагранжа по degree последовательным узлам.
+	 *
+	 * @param points первый из используемых узлов (поля v и t)
+	 * @param t момент
+	 */
+	template <std::size_t degree, typename P, typename T>
+	auto lagrange(P const *points, T const &t)
+	{
+		// P(t) = sum{n = 0..dim} (mult{k = 0..dim, k != n} (t - t_k)/(t_n - t_k)) x_n
+		decltype(points->v) r;
+		double mult;
+		for (size_t n{}; n < degree; ++n)
+		{
+			mult = 1;
+			for (size_t k{}; k < degree; ++k)
+			{
+				if (k != n)
+				{
+					double up = static_cast<double>(t - points[k].t);
+					double down = static_cast<double>(points[n].t - points[k].t);
+					mult *= up / down;
+				}
+			}
+			r += points[n].v * mult;
+		}
+		return r;
+	}
+
+	/**
+	 * @brief Интерполяционный полином Эрмита на отрезке сетки, коэффициенты которого вычисляются по узлам один раз для любого кол-ва точек отрезка.
+	 * Полином проходит через значения и производные в nodes последовательных узлах, содержащих отрезок (степень 2 * nodes - 1),
+	 * и хранится в форме Ньютона, поэтому вычисление в точке - это 2 * nodes - 1 операций *= и += по схеме Горнера.
+	 * Время отсчитывается от начала отрезка в долях его длины.
+	 *
+	 * @tparam V тип вектора
+	 * @tparam nodes наибольшее кол-во узлов
+	 */
+	template <typename V, std::size_t nodes>
+	struct hermite_segment
+	{
+		/**
+		 * @brief Кол-во используемых узлов
+		 */
+		std::size_t count;
+		/**
+		 * @brief Узлы в долях длины отрезка
+		 */
+		double z[nodes];
+		/**
+		 * @brief Коэффициенты полинома в форме Ньютона по узлам кратности 2
+		 */
+		V c[2 * nodes];
+
+		hermite_segment() = default;
+		/**
+		 * @brief Вычисление коэффициентов разделёнными разностями.
+		 *
+		 * @param points узлы (поля v, d и t)
+		 * @param size кол-во узлов
+		 * @param index индекс начального узла отрезка
+		 */
+		template <typename P>
+		hermite_segment(P const *points, std::size_t size, std::size_t index)
+		{
+			count = min_of(nodes, size);
+			// окно узлов, в середине которого находится отрезок
+			std::size_t first = index - min_of(index, (count - 1) / 2);
+			first = min_of(first, size - count);
+			auto step = points[index + 1].t - points[index].t;
+			for (std::size_t i{}; i < count; ++i)
+			{
+				z[i] = static_cast<double>(points[first + i].t - points[index].t) / static_cast<double>(step);
+				c[2 * i] = points[first + i].v;
+				c[2 * i + 1] = points[first + i].v;
+			}
+			std::size_t size2 = 2 * count;
+			for (std::size_t order{1}; order < size2; ++order)
+			{
+				for (std::size_t k{size2 - 1}; k >= order; --k)
+				{
+					if (order == 1 && k % 2 == 1)
+					{
+						// производная по времени в долях длины отрезка
+						c[k] = points[first + k / 2].d * step;
+						continue;
+					}
+					c[k] += c[k - 1] * -1.;
+					c[k] *= 1 / (z[k / 2] - z[(k - order) / 2]);
+				}
+			}
+		}
+		/**
+		 * @brief Значение полинома.
+		 *
+		 * @param s время от начала отрезка в долях его длины
+		 */
+		V operator()(double s) const
+		{
+			std::size_t k{2 * count - 1};
+			V r = c[k];
+			while (k-- > 0)
+			{
+				r *= s - z[k / 2];
+				r += c[k];
+			}
+			return r;
+		}
+	};
+
+	/**
+	 * @brief Шаг по формулам Фельберга 7(8).
+	 *
+	 * @param v, t, d исходный вектор, момент и производная в нём
+	 * @param out решение 8-го порядка
+	 * @param error разность решений 7-го и 8-го порядков
+	 */
+	template <typename V, typename T, typename D, typename F>
+	void rkf78(V const &v, T const &t, V const &d, D const &step, F &func, V &out, V &error)
+	{
+		constexpr std::size_t stages{13};
+		constexpr double c[stages]{0, 2. / 27, 1. / 9, 1. / 6, 5. / 12, 1. / 2, 5. / 6, 1. / 6, 2. / 3, 1. / 3, 1, 0, 1};
+		constexpr double a[stages][stages - 1]{
+			{},
+			{2. / 27},
+			{1. / 36, 1. / 12},
+			{1. / 24, 0, 1. / 8},
+			{5. / 12, 0, -25. / 16, 25. / 16},
+			{1. / 20, 0, 0, 1. / 4, 1. / 5},
+			{-25. / 108, 0, 0, 125. / 108, -65. / 27, 125. / 54},
+			{31. / 300, 0, 0, 0, 61. / 225, -2. / 9, 13. / 900},
+			{2, 0, 0, -53. / 6, 704. / 45, -107. / 9, 67. / 90, 3},
+			{-91. / 108, 0, 0, 23. / 108, -976. / 135, 311. / 54, -19. / 60, 17. / 6, -1. / 12},
+			{2383. / 4100, 0, 0, -341. / 164, 4496. / 1025, -301. / 82, 2133. / 4100, 45. / 82, 45. / 164, 18. / 41},
+			{3. / 205, 0, 0, 0, 0, -6. / 41, -3. / 205, -3. / 41, 3. / 41, 6. / 41, 0},
+			{-1777. / 4100, 0, 0, -341. / 164, 4496. / 1025, -289. / 82, 2193. / 4100, 51. / 82, 33. / 164, 12. / 41, 0, 1},
+		};
+		// веса формулы 8-го порядка
+		constexpr double b[stages]{0, 0, 0, 0, 0, 34. / 105, 9. / 35, 9. / 35, 9. / 280, 9. / 280, 0, 41. / 840, 41. / 840};
+		V k[stages];
+		// производная в начале шага известна вызывающей стороне
+		k[0] = d;
+		for (std::size_t i{1}; i < stages; ++i)
+		{
+			V sum = k[0] * a[i][0];
+			for (std::size_t j{1}; j < i; ++j)
+			{
+				if (a[i][j] != 0)
+					sum += k[j] * a[i][j];
+			}
+			k[i] = func(v + sum * step, t + static_cast<D>(c[i] * static_cast<double>(step)));
+		}
+		V sum = k[5] * b[5];
+		for (std::size_t i{6}; i < stages; ++i)
+		{
+			if (b[i] != 0)
+				sum += k[i] * b[i];
+		}
+		out = v + sum * step;
+		// разность формул 7-го и 8-го порядков: 41/840 * (k0 + k10 - k11 - k12) * h
+		V diff = k[0] + k[10] + (k[11] + k[12]) * -1.;
+		error = diff * (41. / 840) * step;
+	}
+
+	/**
+	 * @brief Коэффициенты многошаговых формул в разностях назад, получаемые из разложения -x / ln(1 - x) (формулы Адамса-Моултона).
+	 *
+	 * @tparam count кол-во коэффициентов
+	 */
+	template <std::size_t count>
+	struct difference_coefficients
+	{
+		/**
+		 * @brief Адамс-Моултон: y(n) - y(n-1) = h * sum(moulton[j] * del^j f(n))
+		 */
+		double moulton[count]{};
+		/**
+		 * @brief Адамс-Башфорт: y(n+1) - y(n) = h * sum(bashforth[j] * del^j f(n))
+		 */
+		double bashforth[count]{};
+		/**
+		 * @brief Коуэлл (неявная формула для второй производной), квадрат ряда Адамса-Моултона
+		 */
+		double cowell[count]{};
+		/**
+		 * @brief Штёрмер (явная формула для второй производной), частичные суммы ряда Коуэлла
+		 */
+		double stormer[count]{};
+
+		constexpr difference_coefficients()
+		{
+			for (std::size_t j{}; j < count; ++j)
+			{
+				double sum{};
+				for (std::size_t i{}; i < j; ++i)
+					sum += moulton[i] / (j + 1 - i);
+				moulton[j] = j == 0 ? 1 : -sum;
+				bashforth[j] = moulton[j] + (j > 0 ? bashforth[j - 1] : 0);
+				for (std::size_t i{}; i <= j; ++i)
+					cowell[j] += moulton[i] * moulton[j - i];
+				stormer[j] = cowell[j] + (j > 0 ? stormer[j - 1] : 0);
+			}
+		}
+	};
+
+	/**
+	 * @brief Переход от разностей назад к значениям в узлах: sum(diff[d] * del^d f(n)) = sum(out[i] * f(n-i)).
+	 */
+	template <std::size_t count>
+	constexpr void differences_to_ordinates(double const *diff, double (&out)[count])
+	{
+		for (std::size_t i{}; i < count; ++i)
+		{
+			out[i] = 0;
+			for (std::size_t d{i}; d < count; ++d)
+			{
+				// биномиальный коэффициент C(d, i)
+				double binom{1};
+				for (std::size_t k{}; k < i; ++k)
+					binom = binom * (d - k) / (k + 1);
+				out[i] += diff[d] * binom * (i % 2 == 0 ? 1 : -1);
+			}
+		}
+	}
+
 	/**
 	 * @brief Интегратор
 	 *
@@ -25,23 +257,32 @@ namespace math
 		{
 			V v;
 			T t;
+			/**
+			 * @brief Производная (значение правой части) в узле
+			 */
+			V d;
 		};
 
-		std::vector<pair> _points;
-		D _step;
-
 		constexpr static std::size_t degree{8};
 		constexpr static std::size_t ratio{1};
 		constexpr static D zero{};
 
+		std::vector<pair> _points;
+		D _step;
+		/**
+		 * @brief Статистика: вычисления правой части, шаги и запросы векторов (собирается при BALLISTIC_STATISTICS)
+		 */
+		mutable statistics _stats;
+
 	public:
 		integrator(integrator const &) = default;
-		integrator(integrator &&other) noexcept : _points{std::move(other._points)}, _step{other._step} {}
+		integrator(integrator &&other) noexcept : _points{std::move(other._points)}, _step{other._step}, _stats{other._stats} {}
 		integrator &operator=(integrator const &) = default;
 		integrator &operator=(integrator &&other) noexcept
 		{
 			_points.swap(other._points);
 			_step = other._step;
+			_stats = other._stats;
 			return *this;
 		}
 		/**
@@ -56,50 +297,194 @@ namespace math
 		template <typename F>
 		integrator(V const &v, T const &tn, T const &tk, F &&func, D const &step)
 		{
-			if (step == zero)
-				throw_invalid_argument("Шаг интегрирования должен быть отличен от нуля.");
-			if ((step > zero) != (tk > tn))
-				throw_invalid_argument("Знак шага интегрирования не соответствует знаку промежутка интегрирования.");
-			auto count = static_cast<std::size_t>((tk - tn) / step) + 1;
-			_points.resize(count);
-			_points.front() = {v, tn};
+			auto count = nodes_count(tn, tk, step);
+			_points.reserve(count);
 			_step = step;
-			std::size_t index = count > degree ? degree : count;
+			auto rhs = counted(func, &_stats);
+			pair first{v, tn, rhs(v, tn)};
+			_points.push_back(first);
 			// массив производных (значений правой части)
 			V arr[degree]{};
-			// шаг разгона
-			D delta = step / ratio;
-			// разгон
-			for (std::size_t i{1}; i < index; ++i)
+			append(first, arr, 0, count, rhs);
+			statistics::increase(_stats.steps, count - 1);
+		}
+		/**
+		 * @brief Продолжение интегрирования до нового конечного момента без повторного вычисления имеющихся узлов.
+		 * Метод Адамса продолжается по производным, сохранённым в последних узлах, поэтому узлы совпадают
+		 * с интегрированием всего промежутка заново.
+		 *
+		 * @tparam F тип функции правой части с сигнатурой V(*)(V const &, T const &)
+		 * @param tk новое конечное значение промежутка интегрирования
+		 * @param func функция правой части (та же, что и при создании)
+		 */
+		template <typename F>
+		void extend_to(T const &tk, F &&func)
+		{
+			std::size_t size = _points.size();
+			pair last = _points.back();
+			if (_step > zero ? tk < last.t : last.t < tk)
+				throw_invalid_argument("Новый конечный момент предшествует последнему узлу интегрирования.");
+			std::size_t count = static_cast<std::size_t>((tk - last.t) / _step) + size;
+			if (count == size)
+				return;
+			// производные в degree - 1 узлах перед последним (при незавершённом разгоне - во всех)
+			V arr[degree]{};
+			std::size_t from = size < degree ? 0 : size - degree;
+			for (std::size_t k{}; from + k + 1 < size; ++k)
+				arr[k] = _points[from + k].d;
+			_points.reserve(count);
+			// при незавершённом разгоне начало сетки не отбрасывалось, и индекс последнего узла равен size - 1
+			auto rhs = counted(func, &_stats);
+			append(last, arr, size - 1, count, rhs);
+			statistics::increase(_stats.steps, count - size);
+		}
+		/**
+		 * @brief Отбрасывает узлы, предшествующие отрезку, который содержит заданный момент.
+		 * Сохраняется не менее degree последних узлов, чтобы интегрирование можно было продолжить методом Адамса.
+		 *
+		 * @param tn новое начало промежутка
+		 */
+		void trim(T const &tn)
+		{
+			std::size_t size = _points.size();
+			if (size <= degree || (_step > zero ? tn < _points.front().t : _points.front().t < tn))
+				return;
+			auto count = min_of(static_cast<std::size_t>((tn - _points.front().t) / _step), size - degree);
+			_points.erase(_points.begin(), _points.begin() + count);
+		}
+		/**
+		 * @brief Интегрирование без сохранения узлов: каждый узел передаётся потребителю сразу после вычисления.
+		 * В памяти хранится только окно производных метода Адамса, поэтому расход памяти не зависит от длины промежутка.
+		 *
+		 * @tparam F тип функции правой части с сигнатурой V(*)(V const &, T const &)
+		 * @tparam S тип потребителя с сигнатурой void(*)(pair const &)
+		 * @param v исходный вектор
+		 * @param tn начальное значение промежутка интегрирования
+		 * @param tk конечное значение промежутка интегрирования
+		 * @param func функция правой части
+		 * @param step шаг интегрирования
+		 * @param sink потребитель узлов (поля v, t и d), вызывается в направлении интегрирования
+		 * @param stats статистика, в которую добавляются вычисления правой части и шаги
+		 */
+		template <typename F, typename S>
+		static void stream(V const &v, T const &tn, T const &tk, F &&func, D const &step, S &&sink, statistics *stats = nullptr)
+		{
+			auto count = nodes_count(tn, tk, step);
+			auto rhs = counted(func, stats);
+			integrate(v, tn, count, rhs, step, sink);
+			if (stats)
+				statistics::increase(stats->steps, count - 1);
+		}
+		/**
+		 * @brief Интегрирование без сохранения узлов с вычислением векторов на упорядоченные по времени моменты.
+		 * Векторы интерполируются по двум последним узлам так же, как в point(t), поэтому результаты совпадают
+		 * с интегрированием с сохранением узлов, а расход памяти определяется только кол-вом моментов.
+		 *
+		 * @tparam F тип функции правой части с сигнатурой V(*)(V const &, T const &)
+		 * @param v исходный вектор
+		 * @param tn начальное значение промежутка интегрирования
+		 * @param tk конечное значение промежутка интегрирования
+		 * @param func функция правой части
+		 * @param step шаг интегрирования
+		 * @param times моменты в направлении интегрирования из промежутка [tn, tk]
+		 * @param out векторы (по одному на каждый момент)
+		 * @param stats статистика, в которую добавляются вычисления правой части, шаги и запросы
+		 */
+		template <typename F>
+		static void stream(V const &v, T const &tn, T const &tk, F &&func, D const &step, std::span<T const> times, std::span<V> out, statistics *stats = nullptr)
+		{
+			if (out.size() != times.size())
+				throw_invalid_argument("Кол-во векторов не соответствует кол-ву моментов времени.");
+			auto count = nodes_count(tn, tk, step);
+			if (count < 2)
+				throw_invalid_argument("Для интерполяции требуется не менее двух узлов.");
+			bool forward = step > zero;
+			for (std::size_t i{}; i < times.size(); ++i)
 			{
-				pair tmp = _points[i - 1];
-				arr[i - 1] = func(tmp.v, tmp.t);
-				for (std::size_t k{}; k < ratio; ++k)
-				{
-					tmp = rk4(tmp, delta, func);
-					_points[i] = tmp;
-				}
+				T const &t = times[i];
+				if (forward ? (t < tn || tk < t) : (tn < t || t < tk))
+					throw_invalid_argument("Момент времени находится за пределами интервала интегрирования.");
+				if (i > 0 && (forward ? t < times[i - 1] : times[i - 1] < t))
+					throw_invalid_argument("Моменты времени не упорядочены в направлении интегрирования.");
+			}
+			if (stats)
+			{
+				statistics::increase(stats->steps, count - 1);
+				statistics::increase(stats->queries, times.size());
 			}
-			// основной цикл
-			for (std::size_t i{index}; i < count; ++i)
+			// два последних узла
+			pair window[2];
+			std::size_t index{}, computed{};
+			auto rhs = counted(func, stats);
+			integrate(v, tn, count, rhs, step, [&](pair const &node)
+					  {
+						  window[0] = window[1];
+						  window[1] = node;
+						  if (++computed < 2)
+							  return;
+						  // моменты до текущего узла, после последнего узла - экстраполяция по последнему отрезку
+						  bool last = computed == count;
+						  auto before = [&](T const &t)
+						  { return last || (forward ? t < node.t : node.t < t); };
+						  if (index == times.size() || !before(times[index]))
+							  return;
+						  for (; index < times.size() && before(times[index]); ++index)
+							  out[index] = interpolate(window, times[index], step);
+					  });
+		}
+		/**
+		 * @brief Возвращает вектор на заданный момент (интерполяция Эрмита по значениям и производным в узлах).
+		 *
+		 * @param t момент
+		 */
+		V point(T const &t) const
+		{
+			statistics::increase(_stats.queries);
+			return interpolate(_points.data() + segment(t), t, _step);
+		}
+		/**
+		 * @brief Вычисляет векторы на упорядоченные по времени моменты.
+		 *
+		 * @param times моменты в направлении интегрирования
+		 * @param out векторы (по одному на каждый момент)
+		 */
+		void points(std::span<T const> times, std::span<V> out) const
+		{
+			if (out.size() != times.size())
+				throw_invalid_argument("Кол-во векторов не соответствует кол-ву моментов времени.");
+			statistics::increase(_stats.queries, times.size());
+			for (std::size_t i{}; i < times.size(); ++i)
 			{
-				_points[i] = adams(arr, _points[i - 1], step, func);
+				if (i > 0 && (_step > zero ? times[i] < times[i - 1] : times[i - 1] < times[i]))
+					throw_invalid_argument("Моменты времени не упорядочены в направлении интегрирования.");
+				out[i] = interpolate(_points.data() + segment(times[i]), times[i], _step);
 			}
 		}
 		/**
-		 * @brief Возвращает вектор на заданный момент.
+		 * @brief Возвращает векторы на упорядоченные по времени моменты.
+		 *
+		 * @param times моменты в направлении интегрирования
+		 */
+		std::vector<V> points(std::span<T const> times) const
+		{
+			std::vector<V> out(times.size());
+			points(times, out);
+			return out;
+		}
+		/**
+		 * @brief Возвращает вектор на заданный момент (интерполяция полиномом Лагранжа).
 		 *
 		 * @tparam degree используемое кол-во точек аппроксимации
 		 * @param t момент
 		 * @return integratable<V, T>
 		 */
-		template <std::size_t degree = 4>
+		template <std::size_t degree>
 		V point(T const &t) const
 		{
 			static_assert(degree > 1, "Недостаточное кол-во точек для аппроксимации.");
+			statistics::increase(_stats.queries);
 			std::size_t count = _points.size();
 			T tn = _points.front().t;
-			T tk = _points.back().t;
 			if (count < degree)
 				throw_invalid_argument("Степень аппроксимации превосходит кол-во доступных точек.");
 			// индекс первой точки для аппроксимации
@@ -108,29 +493,129 @@ namespace math
 				throw_invalid_argument("Момент времени находится за пределами интервала интегрирования.");
 			index -= min_of(index, degree / 2);
 			index = min_of(index, count - degree);
-			// P(t) = sum{n = 0..dim} (mult{k = 0..dim, k != n} (t - t_k)/(t_n - t_k)) x_n
-			V r;
-			double mult;
-			for (size_t n{}; n < degree; ++n)
+			return lagrange<degree>(_points.data() + index, t);
+		}
+
+	private:
+		/**
+		 * @brief Индекс начального узла отрезка, содержащего заданный момент.
+		 * Последний узел может не доходить до конца промежутка меньше чем на шаг: такие моменты экстраполируются по последнему отрезку.
+		 */
+		std::size_t segment(T const &t) const
+		{
+			std::size_t count = _points.size();
+			if (count < 2)
+				throw_invalid_argument("Для интерполяции требуется не менее двух узлов.");
+			auto index = static_cast<std::size_t>((t - _points.front().t) / _step);
+			if (index > count)
+				throw_invalid_argument("Момент времени находится за пределами интервала интегрирования.");
+			return min_of(index, count - 2);
+		}
+
+		/**
+		 * @brief Кубическая интерполяция Эрмита по значениям и производным в концах отрезка.
+		 * Полином строится при запросе по базисным функциям, поэтому помимо узлов ничего не хранится.
+		 *
+		 * @param segment начальный и конечный узлы отрезка
+		 * @param t момент
+		 */
+		static V interpolate(pair const *segment, T const &t, D const &step)
+		{
+			double h = static_cast<double>(step);
+			double s = static_cast<double>(t - segment[0].t) / h, s2 = s * s, s3 = s2 * s;
+			V r = segment[0].v * (2 * s3 - 3 * s2 + 1);
+			r += segment[0].d * ((s3 - 2 * s2 + s) * h);
+			r += segment[1].v * (3 * s2 - 2 * s3);
+			r += segment[1].d * ((s3 - s2) * h);
+			return r;
+		}
+
+		/**
+		 * @brief Кол-во узлов сетки на промежутке интегрирования.
+		 */
+		static std::size_t nodes_count(T const &tn, T const &tk, D const &step)
+		{
+			if (step == zero)
+				throw_invalid_argument("Шаг интегрирования должен быть отличен от нуля.");
+			if ((step > zero) != (tk > tn))
+				throw_invalid_argument("Знак шага интегрирования не соответствует знаку промежутка интегрирования.");
+			return static_cast<std::size_t>((tk - tn) / step) + 1;
+		}
+
+		/**
+		 * @brief Правая часть со счётчиком вычислений.
+		 */
+		template <typename F>
+		static auto counted(F &func, statistics *stats)
+		{
+			return [&func, stats](V const &v, T const &t)
+			{
+				if (stats)
+					statistics::increase(stats->calls);
+				return func(v, t);
+			};
+		}
+
+		/**
+		 * @brief Вычисление узлов сетки от исходного вектора.
+		 */
+		template <typename F, typename S>
+		static void integrate(V const &v, T const &tn, std::size_t count, F &func, D const &step, S &&sink)
+		{
+			pair prev{v, tn, func(v, tn)};
+			sink(prev);
+			// массив производных (значений правой части)
+			V arr[degree]{};
+			advance(prev, arr, 0, count, func, step, sink);
+		}
+
+		/**
+		 * @brief Продолжение хранимой сетки (общее для конструктора и extend_to).
+		 * Одна и та же реализация advance для обоих вызовов нужна для совпадения узлов: иначе компилятор
+		 * может по-разному объединять умножения и сложения в FMA, и узлы отличаются на ошибки округления.
+		 */
+		template <typename F>
+		void append(pair const &prev, V (&arr)[degree], std::size_t index, std::size_t count, F &func)
+		{
+			advance(prev, arr, index, count, func, _step, [this](pair const &node)
+					{ _points.push_back(node); });
+		}
+
+		/**
+		 * @brief Продолжение сетки от узла с вычисленной производной (разгон методом Рунге-Кутты и метод Адамса).
+		 * Каждый новый узел передаётся потребителю вместе с производной в нём.
+		 *
+		 * @param prev последний вычисленный узел
+		 * @param arr производные в предыдущих узлах (для метода Адамса - в degree - 1 узлах перед prev)
+		 * @param index индекс узла prev на сетке
+		 * @param count кол-во узлов сетки
+		 */
+		template <typename F, typename S>
+		static void advance(pair prev, V (&arr)[degree], std::size_t index, std::size_t count, F &func, D const &step, S &&sink)
+		{
+			// шаг разгона
+			D delta = step / ratio;
+			for (std::size_t i{index}; i + 1 < count; ++i)
 			{
-				mult = 1;
-				for (size_t k{}; k < degree; ++k)
+				if (i + 1 < degree)
 				{
-					if (k != n)
-					{
-						double up = static_cast<double>(t - _points[index + k].t);
-						double down = static_cast<double>(_points[index + n].t - _points[index + k].t);
-						mult *= up / down;
-					}
+					// разгон
+					arr[i] = prev.d;
+					for (std::size_t k{}; k < ratio; ++k)
+						prev = rk4(prev, delta, func);
+				}
+				else
+				{
+					arr[degree - 1] = prev.d;
+					prev = adams(arr, prev, step, func);
 				}
-				r += _points[index + n].v * mult;
+				prev.d = func(prev.v, prev.t);
+				sink(prev);
 			}
-			return r;
 		}
 
-	private:
 		template <typename F>
-		pair rk4(pair const &in, D const &step, F &func)
+		static pair rk4(pair const &in, D const &step, F &func)
 		{
 			pair out{};
 			D step_2 = step / 2, step_6 = step / 6;
@@ -145,51 +630,1144 @@ namespace math
 			return out;
 		}
 
+		/**
+		 * @brief Коэффициенты формул Адамса-Башфорта (предиктор) и Адамса-Моултона (корректор)
+		 * при производных от ранней к поздней (у корректора последний - при производной в новом узле).
+		 */
+		struct weights
+		{
+			double predictor[degree]{}, corrector[degree]{};
+
+			constexpr weights()
+			{
+				constexpr difference_coefficients<degree> c;
+				double bashforth[degree]{}, moulton[degree]{};
+				differences_to_ordinates(c.bashforth, bashforth);
+				differences_to_ordinates(c.moulton, moulton);
+				for (std::size_t i{}; i < degree; ++i)
+				{
+					predictor[i] = bashforth[degree - 1 - i];
+					corrector[i] = moulton[degree - 1 - i];
+				}
+			}
+		};
+
 		template <typename F>
-		pair adams(V (&arr)[8], pair const &in, D const &step, F &func)
+		static pair adams(V (&arr)[degree], pair const &in, D const &step, F &func)
 		{
-			constexpr double b[8]{
-				-0.3042245370370370572,
-				2.445163690476190421,
-				-8.612127976190476986,
-				17.37965443121693454,
-				-22.02775297619047734,
-				18.05453869047619264,
-				-9.525206679894179018,
-				3.589955357142857295,
-			};
-			constexpr double c[8]{
-				0.01136739417989418056,
-				-0.09384093915343914849,
-				0.343080357142857173,
-				-0.732035383597883671,
-				1.017964616402116551,
-				-1.0069196428571429713,
-				1.156159060846560838,
-				0.3042245370370370017,
-			};
-			arr[7] = func(in.v, in.t);
+			constexpr weights w;
+			// производная в исходном узле arr[degree - 1] вычислена вызывающей стороной
 			// значение по корректору
 			pair out{};
 			// значение по предиктору
-			V x = arr[0] * b[0];
-			for (std::size_t i{1}; i < 8; ++i)
+			V x = arr[0] * w.predictor[0];
+			for (std::size_t i{1}; i < degree; ++i)
 			{
 				// prediction
-				x += arr[i] * b[i];
+				x += arr[i] * w.predictor[i];
 				// correction
-				out.v += arr[i] * c[i - 1];
+				out.v += arr[i] * w.corrector[i - 1];
 				// renew
 				arr[i - 1] = arr[i];
 			}
 			x = x * step;
 			x += in.v;
 			out.t = in.t + step;
-			out.v += func(x, out.t) * c[7];
+			out.v += func(x, out.t) * w.corrector[degree - 1];
 			out.v = out.v * step;
 			out.v += in.v;
 			return out;
 		}
 	};
 
-}
\ No newline at end of file
+
+	/**
+	 * @brief Интегрирование в обе стороны от момента начальных условий, лежащего внутри промежутка.
+	 * Дуги назад и вперёд вычисляются одновременно в двух потоках и используются как один прогноз.
+	 *
+	 * @tparam V, T, D те же требования, что и для integrator, а также <(T) и -(D)
+	 */
+	template <typename V, typename T, typename D>
+	class bidirectional_integrator
+	{
+	public:
+		using arc = integrator<V, T, D>;
+
+		/**
+		 * @brief Момент начальных условий
+		 */
+		T _epoch;
+		/**
+		 * @brief Дуга от момента начальных условий к концу промежутка
+		 */
+		arc _forward;
+		/**
+		 * @brief Дуга от момента начальных условий к началу промежутка (с отрицательным шагом)
+		 */
+		arc _backward;
+
+	public:
+		/**
+		 * @brief Construct a new bidirectional integrator object
+		 * Дуга назад вычисляется в отдельном потоке с копией функции правой части, дуга вперёд - в вызывающем потоке,
+		 * поэтому правая часть должна допускать одновременные вызовы из разных копий.
+		 *
+		 * @tparam F тип функции правой части с сигнатурой V(*)(V const &, T const &)
+		 * @param v вектор на момент начальных условий
+		 * @param t момент начальных условий (tn < t < tk)
+		 * @param tn начальное значение промежутка
+		 * @param tk конечное значение промежутка
+		 * @param func функция правой части
+		 * @param step шаг интегрирования (положительный)
+		 */
+		template <typename F>
+		bidirectional_integrator(V const &v, T const &t, T const &tn, T const &tk, F &&func, D const &step)
+			: bidirectional_integrator(launch(v, t, tn, tk, func, step), v, t, tk, func, step)
+		{
+		}
+		/**
+		 * @brief Возвращает вектор на заданный момент по дуге, содержащей этот момент.
+		 *
+		 * @param t момент
+		 */
+		V point(T const &t) const
+		{
+			return t < _epoch ? _backward.point(t) : _forward.point(t);
+		}
+		/**
+		 * @brief Вычисляет векторы на упорядоченные по возрастанию моменты.
+		 *
+		 * @param times моменты
+		 * @param out векторы (по одному на каждый момент)
+		 */
+		void points(std::span<T const> times, std::span<V> out) const
+		{
+			if (out.size() != times.size())
+				throw_invalid_argument("Кол-во векторов не соответствует кол-ву моментов времени.");
+			// кол-во моментов на дуге назад
+			std::size_t middle{};
+			while (middle < times.size() && times[middle] < _epoch)
+			{
+				if (middle > 0 && times[middle] < times[middle - 1])
+					throw_invalid_argument("Моменты времени не упорядочены по возрастанию.");
+				++middle;
+			}
+			for (std::size_t i{}; i < middle; ++i)
+				out[i] = _backward.point(times[i]);
+			_forward.points(times.subspan(middle), out.subspan(middle));
+		}
+		/**
+		 * @brief Возвращает векторы на упорядоченные по возрастанию моменты.
+		 *
+		 * @param times моменты
+		 */
+		std::vector<V> points(std::span<T const> times) const
+		{
+			std::vector<V> out(times.size());
+			points(times, out);
+			return out;
+		}
+
+	private:
+		template <typename F>
+		bidirectional_integrator(std::future<arc> backward, V const &v, T const &t, T const &tk, F &func, D const &step)
+			: _epoch{t}, _forward{v, t, tk, func, step}, _backward{backward.get()}
+		{
+		}
+
+		/**
+		 * @brief Запуск интегрирования назад в отдельном потоке.
+		 */
+		template <typename F>
+		static std::future<arc> launch(V const &v, T const &t, T const &tn, T const &tk, F &func, D const &step)
+		{
+			if (!(tn < t && t < tk))
+				throw_invalid_argument("Момент начальных условий должен находиться внутри промежутка интегрирования.");
+			return std::async(std::launch::async, [v, t, tn, func, step]() mutable
+							  { return arc{v, t, tn, func, -step}; });
+		}
+	};
+
+	/**
+	 * @brief Параллельное по времени интегрирование длинного промежутка (Parareal).
+	 * Промежуток делится на отрезки из целого числа шагов точной модели. Грубая модель (упрощённая правая часть, крупный шаг)
+	 * последовательно даёт векторы на границах отрезков, точная модель интегрирует все отрезки одновременно,
+	 * затем векторы на границах уточняются последовательной поправкой U[j + 1] = G(U[j]) + F(U'[j]) - G(U'[j]),
+	 * где U' - векторы предыдущей итерации. Итерации повторяются, пока векторы на границах не перестанут изменяться.
+	 * После k итераций первые k отрезков совпадают с последовательным интегрированием, поэтому они больше не пересчитываются.
+	 * Остальные отрезки после сходимости отличаются от последовательного интегрирования на величину порядка допустимого изменения.
+	 * Итераций намного меньше, чем отрезков, только если грубая модель близка к точной на длине отрезка, а допустимое изменение
+	 * не меньше погрешности самого интегрирования: для 16x16 с Солнцем и Луной (метод Адамса, шаг 30 с) на двух неделях
+	 * грубая модель из геопотенциала 8x8 (метод Гаусса-Джексона, шаг 2 мин) сходится с допустимым изменением 1e-7
+	 * за 4-6 итераций на 32-128 отрезках; геопотенциал 4x4 требует 8-9 итераций, а допустимое изменение 1e-8 - до 16.
+	 * Время работы не меньше (путь / вычисления) * T + итерации * Tg, где T - время последовательного интегрирования точной
+	 * моделью, путь - вычисления точной модели на самом долгом пути (_path, с разгоном отрезков), Tg - грубой моделью
+	 * всего промежутка, и достигается только при потоке на каждый отрезок. При меньшем кол-ве потоков интегрирование
+	 * медленнее последовательного; для моделей выше ускорение при потоке на отрезок 2-3 раза.
+	 *
+	 * @tparam V те же требования, что и для integrator, а также -(V), size() и operator[] (для проверки сходимости)
+	 * @tparam T, D те же требования, что и для integrator, а также <(T)
+	 */
+	template <typename V, typename T, typename D>
+	class parareal_integrator
+	{
+	public:
+		using arc = integrator<V, T, D>;
+
+		/**
+		 * @brief Во сколько раз уменьшается шаг разгона в начале отрезков
+		 */
+		constexpr static std::size_t refine{4};
+		/**
+		 * @brief Границы отрезков (начало промежутка, начала следующих отрезков и конец промежутка)
+		 */
+		std::vector<T> _bounds;
+		/**
+		 * @brief Дуги точной модели на отрезках
+		 */
+		std::vector<arc> _arcs;
+		/**
+		 * @brief Кол-во выполненных итераций (интегрирований точной моделью)
+		 */
+		std::size_t _iterations{};
+		/**
+		 * @brief Сошлись ли итерации (иначе точны только первые _iterations отрезков)
+		 */
+		bool _converged{};
+		/**
+		 * @brief Кол-во вычислений правой части точной модели на самом длинном пути: сумма по итерациям наибольшего
+		 * кол-ва вычислений на отрезке (с разгоном). При потоке на каждый отрезок время точной модели пропорционально ему.
+		 */
+		std::size_t _path{};
+
+	public:
+		/**
+		 * @brief Construct a new parareal integrator object
+		 * Отрезки интегрируются в нескольких потоках (par::parallel_for) с копиями функции правой части точной модели,
+		 * поэтому она должна допускать одновременные вызовы из разных копий. Грубая модель вызывается последовательно.
+		 *
+		 * @tparam F тип функции правой части точной модели с сигнатурой V(*)(V const &, T const &)
+		 * @tparam G тип грубой модели с сигнатурой V(*)(V const &v, T const &tn, T const &tk) - вектор на момент tk
+		 * по вектору v на момент tn (например, интегрирование другим методом с крупным шагом)
+		 * @param v исходный вектор
+		 * @param tn начальное значение промежутка
+		 * @param tk конечное значение промежутка (tn < tk)
+		 * @param fine функция правой части точной модели
+		 * @param fine_step шаг интегрирования точной модели (положительный)
+		 * @param coarse грубая модель
+		 * @param slices кол-во отрезков (не меньше кол-ва доступных потоков)
+		 * @param tolerance допустимое изменение векторов на границах за итерацию относительно наибольшей по модулю компоненты
+		 * @param max_iterations наибольшее кол-во итераций (при недостаточной сходимости результат - последняя итерация, см. _converged)
+		 */
+		template <typename F, typename G>
+		parareal_integrator(V const &v, T const &tn, T const &tk, F &&fine, D const &fine_step, G &&coarse,
+							std::size_t slices, double tolerance, std::size_t max_iterations)
+		{
+			if (!(tn < tk) || !(D{} < fine_step))
+				throw_invalid_argument("Промежуток и шаг интегрирования должны быть положительными.");
+			if (slices == 0 || max_iterations == 0)
+				throw_invalid_argument("Кол-во отрезков и итераций должно быть положительным.");
+			// отрезки из целого числа шагов, чтобы узлы совпадали с последовательным интегрированием
+			auto steps = static_cast<std::size_t>((tk - tn) / fine_step);
+			std::size_t length = std::max<std::size_t>((steps + slices - 1) / slices, 1);
+			_bounds.push_back(tn);
+			for (std::size_t done{}; done + length < steps; done += length)
+			{
+				T t = _bounds.back();
+				for (std::size_t i{}; i < length; ++i)
+					t = t + fine_step;
+				_bounds.push_back(t);
+			}
+			_bounds.push_back(tk);
+			std::size_t count = _bounds.size() - 1;
+			// векторы на границах, векторы в концах отрезков по грубой и точной моделям
+			std::vector<V> u(count + 1), g(count), f(count);
+			u[0] = v;
+			for (std::size_t j{}; j + 1 < count; ++j)
+				u[j + 1] = g[j] = coarse(u[j], _bounds[j], _bounds[j + 1]);
+			_arcs.reserve(count);
+			std::vector<std::optional<arc>> next(count);
+			std::vector<std::size_t> calls(count);
+			for (std::size_t first{}; first < count && _iterations < max_iterations; ++first)
+			{
+				++_iterations;
+				par::parallel_for(first, count, [&](std::size_t j)
+								  {
+									  std::remove_cvref_t<F> func{fine};
+									  std::size_t n{};
+									  auto counted = [&func, &n](V const &x, T const &t)
+									  {
+										  ++n;
+										  return func(x, t);
+									  };
+									  next[j].emplace(continuation(j, u[j], j == first, counted, fine_step));
+									  calls[j] = n; });
+				_path += *std::max_element(calls.begin() + first, calls.end());
+				for (std::size_t j{first}; j < count; ++j)
+					store(j, std::move(*next[j]));
+				for (std::size_t j{first}; j + 1 < count; ++j)
+					f[j] = _arcs[j].point(_bounds[j + 1]);
+				// начало отрезка first точное, поэтому вектор в его конце - вектор точной модели (без поправки)
+				double change{};
+				if (first + 1 < count)
+				{
+					change = difference(f[first], u[first + 1], tolerance);
+					u[first + 1] = f[first];
+				}
+				for (std::size_t j{first + 1}; j + 1 < count; ++j)
+				{
+					V end = coarse(u[j], _bounds[j], _bounds[j + 1]);
+					V corrected = end + f[j] - g[j];
+					change = std::max(change, difference(corrected, u[j + 1], tolerance));
+					u[j + 1] = corrected;
+					g[j] = end;
+				}
+				if (change <= 1)
+				{
+					_converged = true;
+					break;
+				}
+			}
+		}
+		/**
+		 * @brief Construct a new parareal integrator object с грубой моделью в виде функции правой части,
+		 * которая интегрируется тем же методом с крупным шагом (на коротком отрезке шаг уменьшается до его длины).
+		 *
+		 * @tparam G тип функции правой части грубой модели с сигнатурой V(*)(V const &, T const &)
+		 * @param coarse_step шаг интегрирования грубой модели (положительный)
+		 */
+		template <typename F, typename G>
+		parareal_integrator(V const &v, T const &tn, T const &tk, F &&fine, D const &fine_step, G &&coarse, D const &coarse_step,
+							std::size_t slices, double tolerance, std::size_t max_iterations)
+			: parareal_integrator(v, tn, tk, std::forward<F>(fine), fine_step, stepper(coarse, coarse_step), slices, tolerance, max_iterations)
+		{
+		}
+		/**
+		 * @brief Возвращает вектор на заданный момент по дуге отрезка, содержащего этот момент.
+		 *
+		 * @param t момент
+		 */
+		V point(T const &t) const
+		{
+			return _arcs[slice(t)].point(t);
+		}
+		/**
+		 * @brief Вычисляет векторы на упорядоченные по возрастанию моменты.
+		 *
+		 * @param times моменты
+		 * @param out векторы (по одному на каждый момент)
+		 */
+		void points(std::span<T const> times, std::span<V> out) const
+		{
+			if (out.size() != times.size())
+				throw_invalid_argument("Кол-во векторов не соответствует кол-ву моментов времени.");
+			for (std::size_t begin{}; begin < times.size();)
+			{
+				// моменты на одном отрезке вычисляются одним обращением к его дуге
+				std::size_t index = slice(times[begin]);
+				std::size_t end{begin + 1};
+				while (end < times.size() && (index + 1 == _arcs.size() || times[end] < _bounds[index + 1]))
+					++end;
+				// порядок внутри отрезка проверяется его дугой
+				_arcs[index].points(times.subspan(begin, end - begin), out.subspan(begin, end - begin));
+				begin = end;
+			}
+		}
+		/**
+		 * @brief Возвращает векторы на упорядоченные по возрастанию моменты.
+		 *
+		 * @param times моменты
+		 */
+		std::vector<V> points(std::span<T const> times) const
+		{
+			std::vector<V> out(times.size());
+			points(times, out);
+			return out;
+		}
+
+	private:
+		/**
+		 * @brief Индекс отрезка, содержащего заданный момент.
+		 */
+		std::size_t slice(T const &t) const
+		{
+			auto it = std::upper_bound(_bounds.begin() + 1, _bounds.end() - 1, t);
+			return static_cast<std::size_t>(it - (_bounds.begin() + 1));
+		}
+
+		/**
+		 * @brief Дуга отрезка от заданного начального вектора.
+		 * Отрезок с точным началом продолжает метод Адамса по производным в последних узлах дуги предыдущего отрезка
+		 * (как extend_to), поэтому его узлы совпадают с последовательным интегрированием. Остальные отрезки начинаются
+		 * с разгона с шагом, уменьшенным в refine раз: погрешность разгона методом Рунге-Кутты с шагом метода Адамса
+		 * (около 0.2 м на низкой орбите при шаге 30 с) добавлялась бы на каждой границе и накапливалась бы по отрезкам.
+		 *
+		 * @param index индекс отрезка
+		 * @param v начальный вектор
+		 * @param exact совпадает ли начальный вектор с концом дуги предыдущего отрезка
+		 */
+		template <typename F>
+		arc continuation(std::size_t index, V const &v, bool exact, F &fine, D const &step) const
+		{
+			T const &tn = _bounds[index], &tk = _bounds[index + 1];
+			if (index == 0)
+				return arc{v, tn, tk, fine, step};
+			if (exact)
+			{
+				arc out = _arcs[index - 1];
+				out.trim(tn);
+				out.extend_to(tk, fine);
+				return out;
+			}
+			// узлы разгона - каждый refine-й узел интегрирования с уменьшенным шагом
+			auto count = std::min(arc::degree - 1, static_cast<std::size_t>((tk - tn) / step));
+			T end = tn;
+			for (std::size_t k{}; k < count; ++k)
+				end = end + step;
+			arc out{v, tn, end, fine, step / refine};
+			count = std::min(count, (out._points.size() - 1) / refine);
+			for (std::size_t k{1}; k <= count; ++k)
+			{
+				out._points[k] = out._points[k * refine];
+				// моменты узлов - как при интегрировании с шагом step, чтобы последний узел совпал с границей
+				out._points[k].t = out._points[k - 1].t + step;
+			}
+			out._points.resize(count + 1);
+			out._step = step;
+			out.extend_to(tk, fine);
+			return out;
+		}
+
+		void store(std::size_t index, arc &&forecast)
+		{
+			if (index < _arcs.size())
+				_arcs[index] = std::move(forecast);
+			else
+				_arcs.push_back(std::move(forecast));
+		}
+
+		/**
+		 * @brief Грубая модель из функции правой части: вектор в конце отрезка интегрированием без сохранения узлов.
+		 */
+		template <typename G>
+		static auto stepper(G &coarse, D const &step)
+		{
+			if (!(D{} < step))
+				throw_invalid_argument("Промежуток и шаги интегрирования должны быть положительными.");
+			return [&coarse, step](V const &v, T const &tn, T const &tk)
+			{
+				// на коротком отрезке шаг уменьшается до его длины
+				D length = tk - tn;
+				V out[1];
+				arc::stream(v, tn, tk, coarse, length < step ? length : step, std::span<T const>{&tk, 1}, std::span<V>{out});
+				return out[0];
+			};
+		}
+
+		/**
+		 * @brief Наибольшее изменение компоненты вектора относительно наибольшей по модулю компоненты в долях допустимого.
+		 * Масштаб общий для всех компонент: близкие к нулю компоненты не требуют недостижимой абсолютной точности.
+		 */
+		static double difference(V const &next, V const &prev, double tolerance)
+		{
+			double diff{}, scale{1};
+			for (std::size_t i{}; i < next.size(); ++i)
+			{
+				diff = std::max(diff, std::abs(next[i] - prev[i]));
+				scale = std::max(scale, std::abs(prev[i]));
+			}
+			return diff / (tolerance * scale);
+		}
+	};
+
+	/**
+	 * @brief Узлы интегрирования с производными и интерполяция Эрмита между ними на сетке с любым (в т.ч. неравномерным) шагом.
+	 * Общая часть интеграторов, сохраняющих значение правой части в узлах (adaptive_integrator, adams_integrator, gauss_jackson):
+	 * полиномы отрезков строятся один раз после интегрирования, отрезок для момента ищется двоичным поиском.
+	 *
+	 * @tparam V тип вектора
+	 * @tparam T должен иметь операторы -(T), <(T)
+	 */
+	template <typename V, typename T>
+	class hermite_output
+	{
+	public:
+		struct pair
+		{
+			V v;
+			T t;
+			/**
+			 * @brief Производная (значение правой части) в узле
+			 */
+			V d;
+		};
+
+		/**
+		 * @brief Кол-во узлов интерполяционного полинома Эрмита на отрезке (степень 7 соответствует порядку интегрирования)
+		 */
+		constexpr static std::size_t nodes{4};
+
+		std::vector<pair> _points;
+		/**
+		 * @brief Коэффициенты интерполяционных полиномов на отрезках сетки
+		 */
+		std::vector<hermite_segment<V, nodes>> _segments;
+		/**
+		 * @brief Статистика: вычисления правой части, шаги и запросы векторов (собирается при BALLISTIC_STATISTICS)
+		 */
+		mutable statistics _stats;
+
+	public:
+		/**
+		 * @brief Возвращает вектор на заданный момент (интерполяция Эрмита по значениям и производным в узлах).
+		 *
+		 * @param t момент
+		 */
+		V point(T const &t) const
+		{
+			statistics::increase(_stats.queries);
+			return value(segment(t), t);
+		}
+		/**
+		 * @brief Вычисляет векторы на упорядоченные по времени моменты.
+		 * Отрезок для очередного момента ищется вперёд от отрезка предыдущего, поэтому сетка проходится один раз.
+		 *
+		 * @param times моменты в направлении интегрирования
+		 * @param out векторы (по одному на каждый момент)
+		 */
+		void points(std::span<T const> times, std::span<V> out) const
+		{
+			if (out.size() != times.size())
+				throw_invalid_argument("Кол-во векторов не соответствует кол-ву моментов времени.");
+			if (times.empty())
+				return;
+			statistics::increase(_stats.queries, times.size());
+			bool forward = _points.back().t > _points.front().t;
+			std::size_t count = _points.size();
+			// проверка границ для первого и последнего моментов
+			segment(times.back());
+			std::size_t index = segment(times.front());
+			for (std::size_t i{}; i < times.size(); ++i)
+			{
+				T const &t = times[i];
+				if (i > 0 && (forward ? t < times[i - 1] : times[i - 1] < t))
+					throw_invalid_argument("Моменты времени не упорядочены в направлении интегрирования.");
+				while (index + 2 < count && !(forward ? t < _points[index + 1].t : _points[index + 1].t < t))
+					++index;
+				out[i] = value(index, t);
+			}
+		}
+		/**
+		 * @brief Возвращает векторы на упорядоченные по времени моменты.
+		 *
+		 * @param times моменты в направлении интегрирования
+		 */
+		std::vector<V> points(std::span<T const> times) const
+		{
+			std::vector<V> out(times.size());
+			points(times, out);
+			return out;
+		}
+
+	protected:
+		/**
+		 * @brief Правая часть со счётчиком вычислений.
+		 */
+		template <typename F>
+		static auto counted(F &func, statistics *stats)
+		{
+			return [&func, stats](V const &v, T const &t)
+			{
+				statistics::increase(stats->calls);
+				return func(v, t);
+			};
+		}
+
+		/**
+		 * @brief Вычисление коэффициентов полиномов на всех отрезках (после получения всех узлов).
+		 * Шагами считаются отрезки сетки (отвергнутые попытки шага не учитываются).
+		 */
+		void build()
+		{
+			std::size_t count = _points.size();
+			statistics::increase(_stats.steps, count - 1);
+			_segments.reserve(count - 1);
+			for (std::size_t i{}; i + 1 < count; ++i)
+				_segments.emplace_back(_points.data(), count, i);
+		}
+
+	private:
+		/**
+		 * @brief Значение интерполяционного полинома отрезка в заданный момент.
+		 */
+		V value(std::size_t index, T const &t) const
+		{
+			auto step = _points[index + 1].t - _points[index].t;
+			return _segments[index](static_cast<double>(t - _points[index].t) / static_cast<double>(step));
+		}
+
+		/**
+		 * @brief Индекс начального узла отрезка, содержащего заданный момент (двоичный поиск по неравномерной сетке).
+		 */
+		std::size_t segment(T const &t) const
+		{
+			std::size_t count = _points.size();
+			if (count < 2)
+				throw_invalid_argument("Для интерполяции требуется не менее двух узлов.");
+			bool forward = _points.back().t > _points.front().t;
+			T const &tn = forward ? _points.front().t : _points.back().t;
+			T const &tk = forward ? _points.back().t : _points.front().t;
+			if (t < tn || tk < t)
+				throw_invalid_argument("Момент времени находится за пределами интервала интегрирования.");
+			// первый узел после заданного момента
+			auto it = std::upper_bound(_points.begin(), _points.end(), t,
+									   [forward](T const &l, pair const &r)
+									   { return forward ? l < r.t : r.t < l; });
+			auto index = static_cast<std::size_t>(it - _points.begin());
+			return min_of(index - min_of(index, 1), count - 2);
+		}
+	};
+
+	/**
+	 * @brief Интегратор с автоматическим выбором шага по оценке локальной погрешности (Рунге-Кутта-Фельберг 7(8)).
+	 * Решение продолжается по формуле 8-го порядка, разность с формулой 7-го порядка служит оценкой погрешности.
+	 * Узлы получаются неравномерными: шаг уменьшается там, где быстро меняется правая часть (перигей), и растёт вдали от него.
+	 *
+	 * @tparam V те же требования, что и для integrator, а также size() и operator[] (для оценки погрешности)
+	 * @tparam T должен быть default constructible и иметь операторы -(T), -=(T), <(T)
+	 * @tparam D тип величины промежутка интегрирования
+	 */
+	template <typename V, typename T, typename D>
+	class adaptive_integrator : public hermite_output<V, T>
+	{
+	public:
+		using base = hermite_output<V, T>;
+		using typename base::pair;
+		using base::_points;
+
+		constexpr static D zero{};
+
+	public:
+		/**
+		 * @brief Construct a new adaptive integrator object
+		 *
+		 * @tparam F тип функции правой части с сигнатурой V(*)(V const &, T const &)
+		 * @param v исходный вектор
+		 * @param tn начальное значение промежутка интегрирования
+		 * @param tk конечное значение промежутка интегрирования
+		 * @param func функция правой части
+		 * @param step начальный шаг интегрирования
+		 * @param tolerance допустимая локальная погрешность на шаге (относительная, для компонент меньше 1 - абсолютная)
+		 */
+		template <typename F>
+		adaptive_integrator(V const &v, T const &tn, T const &tk, F &&func, D const &step, double tolerance)
+		{
+			if (step == zero)
+				throw_invalid_argument("Шаг интегрирования должен быть отличен от нуля.");
+			if ((step > zero) != (tk > tn))
+				throw_invalid_argument("Знак шага интегрирования не соответствует знаку промежутка интегрирования.");
+			if (!(tolerance > 0))
+				throw_invalid_argument("Допустимая погрешность интегрирования должна быть положительной.");
+			auto rhs = this->counted(func, &this->_stats);
+			pair curr{v, tn, rhs(v, tn)};
+			_points.push_back(curr);
+			D h = step;
+			while (curr.t != tk)
+			{
+				// последний шаг заканчивается точно в конце промежутка
+				D rest = tk - curr.t;
+				if (step > zero ? rest < h : rest > h)
+					h = rest;
+				V next, error;
+				rkf78(curr.v, curr.t, curr.d, h, rhs, next, error);
+				double norm = error_norm(error, curr.v, next, tolerance);
+				if (norm <= 1)
+				{
+					curr.v = next;
+					curr.t = curr.t + h;
+					curr.d = rhs(curr.v, curr.t);
+					_points.push_back(curr);
+				}
+				// новый шаг по оценке погрешности (формула 7-го порядка), изменение не более чем в 5 раз
+				double factor = norm > 0 ? 0.9 * std::pow(norm, -1. / 8) : 5.;
+				factor = std::clamp(factor, 0.2, 5.);
+				h = static_cast<D>(static_cast<double>(h) * factor);
+				if (h == zero)
+					throw_invalid_argument("Шаг интегрирования уменьшился до нуля при заданной погрешности.");
+			}
+			this->build();
+		}
+
+	private:
+		/**
+		 * @brief Среднеквадратичная погрешность шага в долях допустимой (шаг принимается, если она не больше 1).
+		 */
+		static double error_norm(V const &error, V const &prev, V const &next, double tolerance)
+		{
+			std::size_t size = error.size();
+			double sum{};
+			for (std::size_t i{}; i < size; ++i)
+			{
+				double scale = tolerance * std::max({1., std::abs(prev[i]), std::abs(next[i])});
+				double e = error[i] / scale;
+				sum += e * e;
+			}
+			return std::sqrt(sum / size);
+		}
+	};
+
+	/**
+	 * @brief Интегрирование методом Адамса переменного порядка и шага (по Шампайну-Гордону).
+	 * На шаге выполняются предиктор Адамса-Башфорта порядка k, вычисление, корректор Адамса-Моултона порядка k + 1 и вычисление.
+	 * Формулы записаны в модифицированных разделённых разностях производных, поэтому при смене шага история не пересчитывается,
+	 * а меняются только коэффициенты. Пока шаг не меняется, используются коэффициенты постоянного шага, вычисляемые при компиляции.
+	 * Порядок и шаг выбираются по оценкам локальной погрешности для порядков k - 2, ..., k + 1.
+	 * Разгон не требуется: интегрирование начинается с порядка 1, и на каждом шаге порядок повышается, а шаг удваивается,
+	 * пока оценка погрешности это допускает.
+	 *
+	 * @tparam V, T, D те же требования, что и для adaptive_integrator
+	 */
+	template <typename V, typename T, typename D>
+	class adams_integrator : public hermite_output<V, T>
+	{
+	public:
+		using base = hermite_output<V, T>;
+		using typename base::pair;
+		using base::_points;
+
+		/**
+		 * @brief Наибольший порядок предиктора
+		 */
+		constexpr static std::size_t order{12};
+		constexpr static D zero{};
+
+	public:
+		/**
+		 * @brief Construct a new adams integrator object
+		 *
+		 * @tparam F тип функции правой части с сигнатурой V(*)(V const &, T const &)
+		 * @param v исходный вектор
+		 * @param tn начальное значение промежутка интегрирования
+		 * @param tk конечное значение промежутка интегрирования
+		 * @param func функция правой части
+		 * @param step начальный шаг интегрирования (уточняется на первых шагах)
+		 * @param tolerance допустимая локальная погрешность на шаге (относительная, для компонент меньше 1 - абсолютная)
+		 */
+		template <typename F>
+		adams_integrator(V const &v, T const &tn, T const &tk, F &&func, D const &step, double tolerance)
+		{
+			if (step == zero)
+				throw_invalid_argument("Шаг интегрирования должен быть отличен от нуля.");
+			if ((step > zero) != (tk > tn))
+				throw_invalid_argument("Знак шага интегрирования не соответствует знаку промежутка интегрирования.");
+			if (!(tolerance > 0))
+				throw_invalid_argument("Допустимая погрешность интегрирования должна быть положительной.");
+			auto rhs = this->counted(func, &this->_stats);
+			pair curr{v, tn, rhs(v, tn)};
+			_points.push_back(curr);
+			// модифицированные разделённые разности производных в последнем узле
+			V phi[order + 2]{};
+			phi[0] = curr.d;
+			history h{};
+			h.step = step;
+			for (std::size_t i{}; i <= order; ++i)
+				h.psi[i] = (i + 1) * static_cast<double>(step);
+			while (curr.t != tk)
+			{
+				// последний шаг заканчивается точно в конце промежутка
+				D rest = tk - curr.t;
+				if (step > zero ? rest < h.step : rest > h.step)
+					h.step = rest;
+				if (attempt(curr, phi, h, rhs, tolerance))
+					_points.push_back(curr);
+				if (h.step == zero)
+					throw_invalid_argument("Шаг интегрирования уменьшился до нуля при заданной погрешности.");
+			}
+			this->build();
+		}
+
+	private:
+		/**
+		 * @brief Состояние метода между шагами
+		 */
+		struct history
+		{
+			/**
+			 * @brief Очередной шаг
+			 */
+			D step;
+			/**
+			 * @brief Последний принятый шаг и кол-во принятых подряд шагов такой величины
+			 */
+			D last;
+			std::size_t constant;
+			/**
+			 * @brief Расстояния от последнего узла до предыдущих: t(n) - t(n-1-i)
+			 */
+			double psi[order + 1];
+			/**
+			 * @brief Порядок предиктора и кол-во неудачных попыток текущего шага
+			 */
+			std::size_t k{1}, failures;
+			/**
+			 * @brief Начальная фаза (повышение порядка и удвоение шага)
+			 */
+			bool start{true};
+		};
+
+		/**
+		 * @brief Коэффициенты шага
+		 */
+		struct coefficients
+		{
+			/**
+			 * @brief Расстояния от нового узла до предыдущих: t(n+1) - t(n-i)
+			 */
+			double psi[order + 1];
+			/**
+			 * @brief Множители модифицированных разностей, коэффициенты формул и множители оценок погрешности
+			 */
+			double beta[order + 1], g[order + 1], sigma[order + 2];
+		};
+
+		/**
+		 * @brief Коэффициенты постоянного шага
+		 */
+		constexpr static difference_coefficients<order + 2> uniform{};
+
+		/**
+		 * @brief Вычисление коэффициентов шага h по расстояниям до предыдущих узлов.
+		 */
+		static void compute(history const &h, coefficients &c)
+		{
+			double step = static_cast<double>(h.step);
+			std::size_t k = h.k;
+			c.psi[0] = step;
+			for (std::size_t i{1}; i <= order; ++i)
+				c.psi[i] = step + h.psi[i - 1];
+			c.sigma[0] = 1;
+			for (std::size_t i{1}; i <= k + 1; ++i)
+				c.sigma[i] = c.sigma[i - 1] * i * step / c.psi[i - 1];
+			// последние k + 1 шагов одинаковы: разности совпадают с разностями назад
+			if (h.step == h.last && k <= h.constant)
+			{
+				for (std::size_t j{}; j <= k; ++j)
+				{
+					c.beta[j] = 1;
+					c.g[j] = uniform.bashforth[j];
+				}
+				return;
+			}
+			c.beta[0] = 1;
+			for (std::size_t j{1}; j <= k; ++j)
+				c.beta[j] = c.beta[j - 1] * c.psi[j - 1] / h.psi[j - 1];
+			// g[j] = c(j, 1), c(0, q) = 1 / q, c(j, q) = c(j - 1, q) - c(j - 1, q + 1) * h / psi[j - 1]
+			double w[order + 2];
+			for (std::size_t q{}; q <= k; ++q)
+				w[q] = 1. / (q + 1);
+			c.g[0] = w[0];
+			for (std::size_t j{1}; j <= k; ++j)
+			{
+				double a = step / c.psi[j - 1];
+				for (std::size_t q{}; q + j <= k; ++q)
+					w[q] -= w[q + 1] * a;
+				c.g[j] = w[0];
+			}
+		}
+
+		/**
+		 * @brief Попытка шага. Если погрешность допустима, узел и разности заменяются новыми.
+		 * В любом случае выбираются порядок и шаг для следующей попытки.
+		 *
+		 * @return принят ли шаг
+		 */
+		template <typename F>
+		static bool attempt(pair &curr, V (&phi)[order + 2], history &h, F &func, double tolerance)
+		{
+			std::size_t k = h.k;
+			coefficients c;
+			compute(h, c);
+			// предиктор
+			V star[order + 1];
+			V sum{};
+			for (std::size_t j{}; j <= k; ++j)
+			{
+				star[j] = phi[j] * c.beta[j];
+				if (j < k)
+					sum += star[j] * c.g[j];
+			}
+			V p = curr.v + sum * h.step;
+			T t = curr.t + h.step;
+			// разности по производной в предсказанном узле
+			V next[order + 2];
+			next[0] = func(p, t);
+			for (std::size_t j{}; j <= k; ++j)
+				next[j + 1] = next[j] + star[j] * -1.;
+			// оценки погрешности для порядков k - 2, k - 1, k
+			auto estimate = [&](V const (&diff)[order + 2], std::size_t q)
+			{
+				return error_norm(diff[q] * (c.sigma[q] * std::abs(uniform.moulton[q])) * h.step, curr.v, tolerance);
+			};
+			double erk = estimate(next, k);
+			double erkm1 = k > 1 ? estimate(next, k - 1) : 0;
+			double erkm2 = k > 2 ? estimate(next, k - 2) : 0;
+			std::size_t knew = k;
+			if (k == 2 && erkm1 <= erk / 2)
+				knew = 1;
+			if (k > 2 && std::max(erkm1, erkm2) <= erk)
+				knew = k - 1;
+			double error = error_norm(next[k] * std::abs(c.g[k - 1] - c.g[k]) * h.step, curr.v, tolerance);
+			if (error > 1)
+			{
+				// уменьшение шага вдвое, после третьей неудачи - по оценке погрешности (не более чем в 10 раз) и с порядком 1
+				h.start = false;
+				double factor = 0.5;
+				if (++h.failures >= 3)
+				{
+					factor = std::clamp(std::sqrt(0.5 / erk), 0.1, 0.5);
+					knew = 1;
+				}
+				h.k = knew;
+				h.step = static_cast<D>(static_cast<double>(h.step) * factor);
+				return false;
+			}
+			// корректор и вычисление
+			curr.v = p + next[k] * c.g[k] * h.step;
+			curr.t = t;
+			curr.d = func(curr.v, curr.t);
+			phi[0] = curr.d;
+			for (std::size_t j{}; j <= k; ++j)
+				phi[j + 1] = phi[j] + star[j] * -1.;
+			h.constant = h.step == h.last ? h.constant + 1 : 1;
+			h.last = h.step;
+			h.failures = 0;
+			std::copy(c.psi, c.psi + order + 1, h.psi);
+			// выбор порядка
+			if (knew < k || k == order)
+				h.start = false;
+			if (h.start)
+			{
+				h.k = k + 1;
+				erk = 0;
+			}
+			else if (knew < k)
+			{
+				h.k = knew;
+				erk = erkm1;
+			}
+			else if (k < h.constant)
+			{
+				// оценка для порядка k + 1 имеет смысл после k + 1 одинаковых шагов
+				double erkp1 = estimate(phi, k + 1);
+				if (k > 1 && erkm1 <= std::min(erk, erkp1))
+				{
+					h.k = k - 1;
+					erk = erkm1;
+				}
+				else if (k < order && (k == 1 ? erkp1 < erk / 2 : erkp1 < erk))
+				{
+					h.k = k + 1;
+					erk = erkp1;
+				}
+			}
+			// выбор шага: удвоение, сохранение или уменьшение не более чем вдвое
+			double factor = 1;
+			if (h.start || erk * std::pow(2., h.k + 1) <= 0.5)
+				factor = 2;
+			else if (erk > 0.5)
+				factor = std::clamp(std::pow(0.5 / erk, 1. / (h.k + 1)), 0.5, 0.9);
+			if (factor != 1)
+				h.step = static_cast<D>(static_cast<double>(h.step) * factor);
+			return true;
+		}
+
+		/**
+		 * @brief Среднеквадратичная величина вектора в долях допустимой погрешности.
+		 */
+		static double error_norm(V const &error, V const &v, double tolerance)
+		{
+			std::size_t size = error.size();
+			double sum{};
+			for (std::size_t i{}; i < size; ++i)
+			{
+				double e = error[i] / (tolerance * std::max(1., std::abs(v[i])));
+				sum += e * e;
+			}
+			return std::sqrt(sum / size);
+		}
+	};
+
+	/**
+	 * @brief Интегратор Гаусса-Джексона (суммированная форма метода Штёрмера-Коуэлла) для уравнений движения второго порядка.
+	 * Положения и скорости вычисляются по вторым и первым суммам ускорений, поэтому на шаг требуется одно вычисление правой части
+	 * (предиктор, вычисление, корректор), а округления не накапливаются, как при двукратном интегрировании системы первого порядка.
+	 * Разгон выполняется шагами Рунге-Кутты-Фельберга 8-го порядка.
+	 *
+	 * @tparam V вектор из положений (первая половина) и скоростей (вторая половина); те же требования, что и для integrator, а также size() и operator[]
+	 * @tparam T должен быть default constructible и иметь операторы -(T), -=(T)
+	 * @tparam D тип величины промежутка интегрирования
+	 */
+	template <typename V, typename T, typename D>
+	class gauss_jackson : public hermite_output<V, T>
+	{
+	public:
+		using base = hermite_output<V, T>;
+		using typename base::pair;
+		using base::_points;
+
+		/**
+		 * @brief Кол-во узлов в формулах (порядок интегрирования)
+		 */
+		constexpr static std::size_t degree{8};
+		constexpr static D zero{};
+		D _step;
+
+	public:
+		/**
+		 * @brief Construct a new gauss jackson object
+		 *
+		 * @tparam F тип функции правой части с сигнатурой V(*)(V const &, T const &); вторая половина результата - ускорения
+		 * @param v исходный вектор
+		 * @param tn начальное значение промежутка интегрирования
+		 * @param tk конечное значение промежутка интегрирования (если промежуток не кратен шагу, последний узел за ним)
+		 * @param func функция правой части
+		 * @param step шаг интегрирования
+		 */
+		template <typename F>
+		gauss_jackson(V const &v, T const &tn, T const &tk, F &&func, D const &step)
+		{
+			if (step == zero)
+				throw_invalid_argument("Шаг интегрирования должен быть отличен от нуля.");
+			if ((step > zero) != (tk > tn))
+				throw_invalid_argument("Знак шага интегрирования не соответствует знаку промежутка интегрирования.");
+			if (v.size() % 2 != 0)
+				throw_invalid_argument("Вектор должен состоять из положений и скоростей одинаковой размерности.");
+			// последний узел не раньше конца промежутка, чтобы вектор на tk получался интерполяцией
+			auto steps = static_cast<std::size_t>((tk - tn) / step);
+			if (tn + step * static_cast<D>(steps) != tk)
+				++steps;
+			std::size_t count = steps + 1;
+			_step = step;
+			_points.reserve(count);
+			auto rhs = this->counted(func, &this->_stats);
+			_points.push_back({v, tn, rhs(v, tn)});
+			// разгон
+			for (std::size_t i{1}; i < min_of(count, degree); ++i)
+			{
+				pair const &prev = _points.back();
+				pair next{};
+				V error;
+				next.t = prev.t + step;
+				rkf78(prev.v, prev.t, prev.d, step, rhs, next.v, error);
+				next.d = rhs(next.v, next.t);
+				_points.push_back(next);
+			}
+			if (count > degree)
+				run(count, rhs);
+			this->build();
+		}
+
+	private:
+		/**
+		 * @brief Коэффициенты формул при ускорениях в узлах n, n-1, ... (от последнего узла к первому).
+		 */
+		struct weights
+		{
+			/**
+			 * @brief Предиктор скорости и положения на узел n+1
+			 */
+			double velocity[degree]{}, position[degree]{};
+			/**
+			 * @brief Корректор скорости и положения в узле n
+			 */
+			double velocity_c[degree]{}, position_c[degree]{};
+
+			constexpr weights()
+			{
+				constexpr difference_coefficients<degree + 2> c;
+				differences_to_ordinates(c.bashforth + 1, velocity);
+				differences_to_ordinates(c.stormer + 2, position);
+				differences_to_ordinates(c.moulton + 1, velocity_c);
+				differences_to_ordinates(c.cowell + 2, position_c);
+			}
+		};
+
+		/**
+		 * @brief Положения из первой половины вектора во второй (суммы ведутся по ускорениям во второй половине).
+		 */
+		static V lift(V const &v)
+		{
+			V out;
+			std::size_t half = v.size() / 2;
+			for (std::size_t i{}; i < half; ++i)
+				out[half + i] = v[i];
+			return out;
+		}
+
+		/**
+		 * @brief Вектор из положений и скоростей во вторых половинах векторов.
+		 */
+		static V merge(V const &position, V const &velocity)
+		{
+			V out;
+			std::size_t half = out.size() / 2;
+			for (std::size_t i{}; i < half; ++i)
+			{
+				out[i] = position[half + i];
+				out[half + i] = velocity[half + i];
+			}
+			return out;
+		}
+
+		/**
+		 * @brief Сумма ускорений в последних degree узлах с заданными коэффициентами.
+		 *
+		 * @param accs ускорения (последнее - в конце)
+		 */
+		static V combine(V const (&accs)[degree], double const (&coefs)[degree])
+		{
+			V out = accs[degree - 1] * coefs[0];
+			for (std::size_t i{1}; i < degree; ++i)
+				out += accs[degree - 1 - i] * coefs[i];
+			return out;
+		}
+
+		/**
+		 * @brief Основной цикл: предиктор, вычисление ускорения, корректор.
+		 */
+		template <typename F>
+		void run(std::size_t count, F &func)
+		{
+			constexpr weights w;
+			D const &h = _step;
+			V accs[degree];
+			for (std::size_t i{}; i < degree; ++i)
+				accs[i] = _points[i].d;
+			pair const &start = _points.back();
+			// первая сумма (скорость) и вторая сумма (положение) ускорений, согласованные с разгоном
+			V sum1 = start.v + combine(accs, w.velocity_c) * h * -1.;
+			V sum2 = lift(start.v) + sum1 * h + combine(accs, w.position_c) * h * h * -1.;
+			for (std::size_t n{degree}; n < count; ++n)
+			{
+				pair next{};
+				next.t = _points.back().t + h;
+				// предиктор
+				V velocity = sum1 + combine(accs, w.velocity) * h;
+				V position = sum2 + combine(accs, w.position) * h * h;
+				next.d = func(merge(position, velocity), next.t);
+				// суммы до нового узла
+				sum1 += next.d * h;
+				sum2 += sum1 * h;
+				for (std::size_t i{1}; i < degree; ++i)
+					accs[i - 1] = accs[i];
+				accs[degree - 1] = next.d;
+				// корректор
+				velocity = sum1 + combine(accs, w.velocity_c) * h;
+				position = sum2 + sum1 * h * -1. + combine(accs, w.position_c) * h * h;
+				next.v = merge(position, velocity);
+				_points.push_back(next);
+			}
+		}
+
+	};
+}
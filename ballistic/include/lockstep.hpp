@@ -0,0 +1,64 @@
+#pragma once
+#include <maths.hpp>
+#include <algorithm>
+#include <span>
+
+namespace math
+{
+	/**
+	 * @brief Размещение нескольких траекторий в одном векторе состояния для совместного интегрирования.
+	 * Компонента i траектории k хранится в элементе i * count + k (structure of arrays), поэтому
+	 * одноимённые компоненты всех траекторий лежат подряд и обрабатываются пакетными вычислениями.
+	 * Такой вектор интегрируется обычным integrator: метод Адамса линеен, и все траектории
+	 * продвигаются по общей сетке, а правая часть вычисляет зависящие только от времени величины один раз на этап.
+	 *
+	 * @tparam size размерность вектора одной траектории
+	 * @tparam count кол-во траекторий
+	 */
+	template <std::size_t size, std::size_t count>
+	struct lockstep
+	{
+		using state = vec<size>;
+		using batch = vec<size * count>;
+
+		/**
+		 * @brief Кол-во траекторий
+		 */
+		static constexpr std::size_t width() { return count; }
+		/**
+		 * @brief Указатель на компоненту i всех траекторий (count элементов подряд)
+		 */
+		static double const *component(batch const &v, std::size_t i) { return v.data() + i * count; }
+		static double *component(batch &v, std::size_t i) { return v.data() + i * count; }
+		/**
+		 * @brief Упаковка векторов траекторий
+		 *
+		 * @param states векторы (недостающие траектории дополняются последним вектором)
+		 */
+		static batch pack(std::span<state const> states)
+		{
+			batch out;
+			for (std::size_t k{}; k < count; ++k)
+			{
+				auto const &v = states[std::min(k, states.size() - 1)];
+				for (std::size_t i{}; i < size; ++i)
+				{
+					out[i * count + k] = v[i];
+				}
+			}
+			return out;
+		}
+		/**
+		 * @brief Вектор траектории k
+		 */
+		static state unpack(batch const &v, std::size_t k)
+		{
+			state out;
+			for (std::size_t i{}; i < size; ++i)
+			{
+				out[i] = v[i * count + k];
+			}
+			return out;
+		}
+	};
+}
@@ -0,0 +1,194 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+#define BALLISTIC_AVX2
+#endif
+
+namespace math
+{
+	/**
+	 * @brief Пакеты значений для векторных ядер.
+	 * Набор инструкций задаётся только для единицы трансляции с копиями пакетных ядер (gptavx2.cpp, BALLISTIC_AVX2 в CMake),
+	 * поэтому в разных единицах трансляции пакеты могут быть разными. Варианты находятся во встроенных пространствах имён
+	 * avx2 и portable, чтобы шаблоны ядер из заголовков, созданные с разными вариантами, не совпадали при компоновке.
+	 */
+	namespace simd
+	{
+#ifdef BALLISTIC_AVX2
+		inline namespace avx2
+		{
+			/**
+			 * @brief Пакет из 4-х значений double, обрабатываемых одной инструкцией AVX2
+			 *
+			 */
+			struct dpack
+			{
+				__m256d v;
+
+				static constexpr std::size_t size{4};
+
+				static dpack broadcast(double x) { return {_mm256_set1_pd(x)}; }
+				static dpack load(double const *p) { return {_mm256_loadu_pd(p)}; }
+				void store(double *p) const { _mm256_storeu_pd(p, v); }
+
+				friend dpack operator+(dpack l, dpack r) { return {_mm256_add_pd(l.v, r.v)}; }
+				friend dpack operator-(dpack l, dpack r) { return {_mm256_sub_pd(l.v, r.v)}; }
+				friend dpack operator*(dpack l, dpack r) { return {_mm256_mul_pd(l.v, r.v)}; }
+				friend dpack operator/(dpack l, dpack r) { return {_mm256_div_pd(l.v, r.v)}; }
+				/**
+				 * @brief a * b + c
+				 */
+				friend dpack fma(dpack a, dpack b, dpack c) { return {_mm256_fmadd_pd(a.v, b.v, c.v)}; }
+				/**
+				 * @brief c - a * b
+				 */
+				friend dpack fnma(dpack a, dpack b, dpack c) { return {_mm256_fnmadd_pd(a.v, b.v, c.v)}; }
+				friend dpack sqrt(dpack x) { return {_mm256_sqrt_pd(x.v)}; }
+			};
+
+			/**
+			 * @brief Пакет из 8-ми значений float, обрабатываемых одной инструкцией AVX2
+			 *
+			 */
+			struct fpack
+			{
+				__m256 v;
+
+				static constexpr std::size_t size{8};
+
+				static fpack broadcast(float x) { return {_mm256_set1_ps(x)}; }
+				static fpack load(float const *p) { return {_mm256_loadu_ps(p)}; }
+				/**
+				 * @brief Пакет (x, x + 1, ..., x + 7)
+				 */
+				static fpack ramp(float x) { return {_mm256_add_ps(_mm256_set1_ps(x), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7))}; }
+				void store(float *p) const { _mm256_storeu_ps(p, v); }
+				/**
+				 * @brief Сумма элементов пакета в двойной точности
+				 */
+				double sum() const
+				{
+					__m256d lo = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+					__m256d hi = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+					__m256d s = _mm256_add_pd(lo, hi);
+					__m128d h = _mm_add_pd(_mm256_castpd256_pd128(s), _mm256_extractf128_pd(s, 1));
+					return _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+				}
+
+				friend fpack operator+(fpack l, fpack r) { return {_mm256_add_ps(l.v, r.v)}; }
+				friend fpack operator-(fpack l, fpack r) { return {_mm256_sub_ps(l.v, r.v)}; }
+				friend fpack operator*(fpack l, fpack r) { return {_mm256_mul_ps(l.v, r.v)}; }
+				/**
+				 * @brief a * b + c
+				 */
+				friend fpack fma(fpack a, fpack b, fpack c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+				/**
+				 * @brief c - a * b
+				 */
+				friend fpack fnma(fpack a, fpack b, fpack c) { return {_mm256_fnmadd_ps(a.v, b.v, c.v)}; }
+			};
+		}
+#else
+		inline namespace portable
+		{
+			/**
+			 * @brief Пакет из 4-х значений double (переносимый вариант без AVX2)
+			 *
+			 */
+			struct dpack
+			{
+				double v[4];
+
+				static constexpr std::size_t size{4};
+
+				static dpack broadcast(double x) { return {{x, x, x, x}}; }
+				static dpack load(double const *p) { return {{p[0], p[1], p[2], p[3]}}; }
+				void store(double *p) const
+				{
+					for (std::size_t i{}; i < size; ++i)
+						p[i] = v[i];
+				}
+
+				template <typename F>
+				static dpack apply(dpack l, dpack r, F f)
+				{
+					dpack out;
+					for (std::size_t i{}; i < size; ++i)
+						out.v[i] = f(l.v[i], r.v[i]);
+					return out;
+				}
+
+				friend dpack operator+(dpack l, dpack r) { return apply(l, r, [](double a, double b) { return a + b; }); }
+				friend dpack operator-(dpack l, dpack r) { return apply(l, r, [](double a, double b) { return a - b; }); }
+				friend dpack operator*(dpack l, dpack r) { return apply(l, r, [](double a, double b) { return a * b; }); }
+				friend dpack operator/(dpack l, dpack r) { return apply(l, r, [](double a, double b) { return a / b; }); }
+				friend dpack fma(dpack a, dpack b, dpack c) { return a * b + c; }
+				friend dpack fnma(dpack a, dpack b, dpack c) { return c - a * b; }
+				friend dpack sqrt(dpack x)
+				{
+					for (auto &e : x.v)
+						e = std::sqrt(e);
+					return x;
+				}
+			};
+
+			/**
+			 * @brief Пакет из 8-ми значений float (переносимый вариант без AVX2)
+			 *
+			 */
+			struct fpack
+			{
+				float v[8];
+
+				static constexpr std::size_t size{8};
+
+				static fpack broadcast(float x) { return {{x, x, x, x, x, x, x, x}}; }
+				static fpack load(float const *p)
+				{
+					fpack out;
+					for (std::size_t i{}; i < size; ++i)
+						out.v[i] = p[i];
+					return out;
+				}
+				static fpack ramp(float x)
+				{
+					fpack out;
+					for (std::size_t i{}; i < size; ++i)
+						out.v[i] = x + i;
+					return out;
+				}
+				void store(float *p) const
+				{
+					for (std::size_t i{}; i < size; ++i)
+						p[i] = v[i];
+				}
+				double sum() const
+				{
+					double s{};
+					for (auto e : v)
+						s += e;
+					return s;
+				}
+
+				template <typename F>
+				static fpack apply(fpack l, fpack r, F f)
+				{
+					fpack out;
+					for (std::size_t i{}; i < size; ++i)
+						out.v[i] = f(l.v[i], r.v[i]);
+					return out;
+				}
+
+				friend fpack operator+(fpack l, fpack r) { return apply(l, r, [](float a, float b) { return a + b; }); }
+				friend fpack operator-(fpack l, fpack r) { return apply(l, r, [](float a, float b) { return a - b; }); }
+				friend fpack operator*(fpack l, fpack r) { return apply(l, r, [](float a, float b) { return a * b; }); }
+				friend fpack fma(fpack a, fpack b, fpack c) { return a * b + c; }
+				friend fpack fnma(fpack a, fpack b, fpack c) { return c - a * b; }
+			};
+		}
+#endif
+	}
+}
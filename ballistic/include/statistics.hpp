@@ -0,0 +1,128 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace math
+{
+	/**
+	 * @brief Сбор статистики включается определением BALLISTIC_STATISTICS (опция CMake).
+	 * Без него счётчики не изменяются, а время не замеряется, поэтому вычисления не замедляются.
+	 */
+#ifdef BALLISTIC_STATISTICS
+	constexpr bool statistics_enabled{true};
+#else
+	constexpr bool statistics_enabled{false};
+#endif
+
+	/**
+	 * @brief Слагаемые правой части уравнений движения, время вычисления которых замеряется отдельно
+	 */
+	enum class force_term : std::size_t
+	{
+		geopotential,
+		/**
+		 * @brief Притяжение Солнца и Луны (вместе с вычислением их положений)
+		 */
+		bodies,
+		radiation,
+		count
+	};
+
+	/**
+	 * @brief Статистика интегрирования и вычисления правых частей.
+	 * Складывается оператором += (или accumulate из нескольких потоков), поэтому собирается по всем прогнозам решения.
+	 */
+	struct statistics
+	{
+		/**
+		 * @brief Кол-во вычислений правой части
+		 */
+		std::size_t calls{};
+		/**
+		 * @brief Кол-во шагов интегрирования
+		 */
+		std::size_t steps{};
+		/**
+		 * @brief Кол-во запросов векторов у прогноза
+		 */
+		std::size_t queries{};
+		/**
+		 * @brief Суммарное время вычисления слагаемых правой части [нс]
+		 */
+		std::uint64_t nanoseconds[static_cast<std::size_t>(force_term::count)]{};
+
+		/**
+		 * @brief Время вычисления слагаемого [нс]
+		 */
+		std::uint64_t time(force_term term) const { return nanoseconds[static_cast<std::size_t>(term)]; }
+
+		statistics &operator+=(statistics const &other)
+		{
+			calls += other.calls;
+			steps += other.steps;
+			queries += other.queries;
+			for (std::size_t i{}; i < static_cast<std::size_t>(force_term::count); ++i)
+				nanoseconds[i] += other.nanoseconds[i];
+			return *this;
+		}
+		/**
+		 * @brief Потокобезопасное добавление статистики (например, из параллельно вычисляемых прогнозов)
+		 */
+		void accumulate(statistics const &other)
+		{
+			if constexpr (statistics_enabled)
+			{
+				increase(calls, other.calls);
+				increase(steps, other.steps);
+				increase(queries, other.queries);
+				for (std::size_t i{}; i < static_cast<std::size_t>(force_term::count); ++i)
+					increase(nanoseconds[i], other.nanoseconds[i]);
+			}
+		}
+
+		/**
+		 * @brief Потокобезопасное увеличение счётчика (только при включённом сборе статистики)
+		 */
+		template <typename U>
+		static void increase(U &counter, U value = 1)
+		{
+			if constexpr (statistics_enabled)
+				std::atomic_ref<U>{counter}.fetch_add(value, std::memory_order_relaxed);
+		}
+	};
+
+	/**
+	 * @brief Вычисление слагаемого правой части с замером времени (только при включённом сборе статистики).
+	 *
+	 * @tparam F тип функции без параметров
+	 * @param stats статистика
+	 * @param term слагаемое
+	 * @param func функция вычисления слагаемого
+	 * @return результат функции
+	 */
+	template <typename F>
+	decltype(auto) timed(statistics &stats, force_term term, F &&func)
+	{
+		if constexpr (statistics_enabled)
+		{
+			auto start = std::chrono::steady_clock::now();
+			struct stop
+			{
+				std::uint64_t &target;
+				std::chrono::steady_clock::time_point start;
+				~stop()
+				{
+					auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+					statistics::increase(target, static_cast<std::uint64_t>(elapsed));
+				}
+			} guard{stats.nanoseconds[static_cast<std::size_t>(term)], start};
+			return func();
+		}
+		else
+		{
+			return func();
+		}
+	}
+}
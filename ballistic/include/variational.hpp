@@ -0,0 +1,118 @@
+#pragma once
+#include <maths.hpp>
+#include <algorithm>
+
+namespace math
+{
+	/**
+	 * @brief Размещение вектора состояния и матрицы чувствительности в одном векторе для совместного интегрирования.
+	 * За вектором состояния (x, y, z, vx, vy, vz) следует матрица 6 x P производных по параметрам, записанная по строкам:
+	 * производная компоненты i по параметру j хранится в элементе 6 + i * P + j. Первые 6 параметров - начальный
+	 * вектор состояния, остальные - параметры модели движения (например, баллистический коэффициент).
+	 * Строка матрицы лежит подряд, поэтому произведения матриц производных ускорения 3x3 на блоки 3xP
+	 * вычисляются по строкам векторными операциями, а лишние столбцы не интегрируются.
+	 *
+	 * @tparam P кол-во параметров (не меньше 6)
+	 */
+	template <std::size_t P>
+	struct variational
+	{
+		static_assert(P >= 6, "Параметры должны включать начальный вектор состояния.");
+
+		using state = vec6;
+		using vector = vec<6 * (P + 1)>;
+
+		/**
+		 * @brief Кол-во параметров
+		 */
+		static constexpr std::size_t parameters() { return P; }
+		/**
+		 * @brief Указатель на строку i матрицы чувствительности (P элементов подряд)
+		 */
+		static double const *row(vector const &v, std::size_t i) { return v.data() + 6 + i * P; }
+		static double *row(vector &v, std::size_t i) { return v.data() + 6 + i * P; }
+		/**
+		 * @brief Производная компоненты i вектора состояния по параметру j
+		 */
+		static double sensitivity(vector const &v, std::size_t i, std::size_t j) { return row(v, i)[j]; }
+		/**
+		 * @brief Начальный вектор: производные по начальному вектору состояния образуют единичную матрицу,
+		 * по параметрам модели - нулевые.
+		 *
+		 * @param s вектор состояния
+		 */
+		static vector initial(double const s[6])
+		{
+			vector out;
+			std::copy(s, s + 6, out.data());
+			for (std::size_t i{}; i < 6; ++i)
+			{
+				row(out, i)[i] = 1;
+			}
+			return out;
+		}
+		/**
+		 * @brief Вектор состояния
+		 */
+		static state unpack(vector const &v)
+		{
+			state out;
+			std::copy(v.data(), v.data() + 6, out.data());
+			return out;
+		}
+		/**
+		 * @brief Производная вектора: производные строк положений - строки скоростей,
+		 * производные строк скоростей - a * R + b * V, где R и V - блоки 3xP строк положений и скоростей.
+		 *
+		 * @param v вектор
+		 * @param ds производная вектора состояния
+		 * @param a производные ускорения по положению
+		 * @param b производные ускорения по скорости
+		 * @return производная вектора (без явных производных ускорения по параметрам модели, см. add_parameter)
+		 */
+		static vector derivative(vector const &v, double const ds[6], mat3x3 const &a, mat3x3 const &b)
+		{
+			vector out;
+			std::copy(ds, ds + 6, out.data());
+			std::copy(row(v, 3), row(v, 6), row(out, 0));
+			multiply(a, row(v, 0), row(out, 3));
+			multiply(b, row(v, 3), row(out, 3));
+			return out;
+		}
+		/**
+		 * @brief Добавление явной производной ускорения по параметру модели.
+		 *
+		 * @param out производная вектора
+		 * @param index номер параметра модели (столбец 6 + index)
+		 * @param da производная ускорения по параметру
+		 */
+		static void add_parameter(vector &out, std::size_t index, double const da[3])
+		{
+			for (std::size_t i{}; i < 3; ++i)
+			{
+				row(out, 3 + i)[6 + index] += da[i];
+			}
+		}
+
+	private:
+		/**
+		 * @brief Произведение матрицы 3x3 на блок 3xP с накоплением: out += m * in (строки блоков по P элементов подряд)
+		 */
+		static void multiply(mat3x3 const &m, double const *in, double *out)
+		{
+			for (std::size_t i{}; i < 3; ++i)
+			{
+				double *dst = out + i * P;
+				for (std::size_t k{}; k < 3; ++k)
+				{
+					double c = m[i][k];
+					double const *src = in + k * P;
+					for (std::size_t j{}; j < P; ++j)
+					{
+						dst[j] += c * src[j];
+					}
+				}
+			}
+		}
+	};
+}
@@ -0,0 +1,131 @@
+#include <chebyshev.hpp>
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+namespace math
+{
+	constexpr char chebyshev_magic[8]{'C', 'H', 'E', 'B', 'E', 'P', 'H', '\0'};
+	constexpr std::uint32_t chebyshev_version{2};
+	/**
+	 * @brief Размер заголовка в файле: сигнатура, четыре 32-битных и четыре 64-битных числа (в версии 1 - три)
+	 */
+	constexpr std::uint64_t chebyshev_header_size(std::uint32_t version)
+	{
+		return sizeof(chebyshev_magic) + 4 * sizeof(std::uint32_t) + (version == 1 ? 3 : 4) * sizeof(std::uint64_t);
+	}
+
+	/**
+	 * @brief Запись целого числа в порядке байт little-endian
+	 */
+	template <typename U>
+	static void put(std::ostream &out, U value)
+	{
+		char bytes[sizeof(U)];
+		for (std::size_t i{}; i < sizeof(U); ++i)
+		{
+			bytes[i] = static_cast<char>(value >> (8 * i) & 0xff);
+		}
+		out.write(bytes, sizeof(U));
+	}
+
+	/**
+	 * @brief Чтение целого числа в порядке байт little-endian
+	 */
+	template <typename U>
+	static U get(std::istream &in)
+	{
+		unsigned char bytes[sizeof(U)]{};
+		in.read(reinterpret_cast<char *>(bytes), sizeof(U));
+		U value{};
+		for (std::size_t i{}; i < sizeof(U); ++i)
+		{
+			value |= static_cast<U>(bytes[i]) << (8 * i);
+		}
+		return value;
+	}
+
+	void write_chebyshev(std::string_view path, chebyshev_header header, std::span<double const> coefs)
+	{
+		std::ofstream fout{std::string{path}, std::ios_base::binary};
+		if (!fout.is_open())
+		{
+			throw std::runtime_error("Не удалось создать файл " + std::string{path});
+		}
+		fout.write(chebyshev_magic, sizeof(chebyshev_magic));
+		put(fout, chebyshev_version);
+		put(fout, header.dimension);
+		put(fout, header.degree);
+		put(fout, header.count);
+		for (double value : {header.tn, header.tk, header.length, header.unit})
+		{
+			put(fout, std::bit_cast<std::uint64_t>(value));
+		}
+		if constexpr (std::endian::native == std::endian::little)
+		{
+			fout.write(reinterpret_cast<char const *>(coefs.data()), coefs.size() * sizeof(double));
+		}
+		else
+		{
+			for (double value : coefs)
+			{
+				put(fout, std::bit_cast<std::uint64_t>(value));
+			}
+		}
+		if (!fout)
+		{
+			throw std::runtime_error("Ошибка записи в файл " + std::string{path});
+		}
+	}
+
+	std::vector<double> read_chebyshev(std::string_view path, chebyshev_header &header)
+	{
+		std::ifstream fin{std::string{path}, std::ios_base::binary};
+		if (!fin.is_open())
+		{
+			throw std::runtime_error("Не удалось открыть файл " + std::string{path});
+		}
+		fin.seekg(0, std::ios_base::end);
+		auto filesize = static_cast<std::uint64_t>(fin.tellg());
+		fin.seekg(0);
+		fin.read(header.magic, sizeof(header.magic));
+		header.version = get<std::uint32_t>(fin);
+		if (!fin || std::memcmp(header.magic, chebyshev_magic, sizeof(chebyshev_magic)) != 0 || (header.version != 1 && header.version != chebyshev_version))
+		{
+			throw std::runtime_error("Файл " + std::string{path} + " не является двоичным файлом эфемерид.");
+		}
+		header.dimension = get<std::uint32_t>(fin);
+		header.degree = get<std::uint32_t>(fin);
+		header.count = get<std::uint32_t>(fin);
+		header.tn = std::bit_cast<double>(get<std::uint64_t>(fin));
+		header.tk = std::bit_cast<double>(get<std::uint64_t>(fin));
+		header.length = std::bit_cast<double>(get<std::uint64_t>(fin));
+		header.unit = header.version == 1 ? 0 : std::bit_cast<double>(get<std::uint64_t>(fin));
+		// размер коэффициентов сверяется с размером файла до выделения памяти (произведение 32-битных чисел не переполняется)
+		std::uint64_t segment = std::uint64_t{header.dimension} * (std::uint64_t{header.degree} + 1);
+		std::uint64_t size = chebyshev_header_size(header.version);
+		std::uint64_t available = (filesize - size) / sizeof(double);
+		if (!fin || header.count == 0 || segment == 0 || !(header.length > 0) || !(header.unit >= 0) ||
+			segment > available / header.count || filesize != size + segment * header.count * sizeof(double))
+		{
+			throw std::runtime_error("Файл " + std::string{path} + " повреждён.");
+		}
+		std::vector<double> coefs(std::size_t{header.count} * header.dimension * (header.degree + 1));
+		if constexpr (std::endian::native == std::endian::little)
+		{
+			fin.read(reinterpret_cast<char *>(coefs.data()), coefs.size() * sizeof(double));
+		}
+		else
+		{
+			for (double &value : coefs)
+			{
+				value = std::bit_cast<double>(get<std::uint64_t>(fin));
+			}
+		}
+		if (!fin)
+		{
+			throw std::runtime_error("Файл " + std::string{path} + " повреждён.");
+		}
+		return coefs;
+	}
+}
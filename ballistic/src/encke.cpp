@@ -0,0 +1,84 @@
+#include <encke.hpp>
+#include <cmath>
+
+using namespace math;
+
+/**
+ * @brief Функции Штумпфа C(z) и S(z)
+ */
+static void stumpff(double z, double &c, double &s)
+{
+	if (std::abs(z) < 1e-2)
+	{
+		// ряды (вблизи нуля формулы ниже теряют точность при вычитании)
+		c = 1. / 2 - z * (1. / 24 - z * (1. / 720 - z * (1. / 40320 - z / 3628800)));
+		s = 1. / 6 - z * (1. / 120 - z * (1. / 5040 - z * (1. / 362880 - z / 39916800)));
+	}
+	else if (z > 0)
+	{
+		double x = std::sqrt(z);
+		c = (1 - std::cos(x)) / z;
+		s = (x - std::sin(x)) / (z * x);
+	}
+	else
+	{
+		double x = std::sqrt(-z);
+		c = (std::cosh(x) - 1) / -z;
+		s = (std::sinh(x) - x) / (-z * x);
+	}
+}
+
+kepler_motion::kepler_motion(double const r[3], double const v[3], double mu) : _mu{mu}
+{
+	double rr{}, vv{}, rv{};
+	for (std::size_t i{}; i < 3; ++i)
+	{
+		_r[i] = r[i];
+		_v[i] = v[i];
+		rr += sqr(r[i]);
+		vv += sqr(v[i]);
+		rv += r[i] * v[i];
+	}
+	_r0 = std::sqrt(rr);
+	_sigma = rv / std::sqrt(mu);
+	_alpha = 2 / _r0 - vv / mu;
+}
+
+void kepler_motion::operator()(double dt, double r[3], double v[3]) const
+{
+	double sqrt_mu = std::sqrt(_mu);
+	// универсальная аномалия: sigma * x^2 * C + (1 - alpha * r0) * x^3 * S + r0 * x = sqrt(mu) * dt (метод Ньютона)
+	double x = sqrt_mu * dt * (_alpha > 0 ? _alpha : 1 / _r0);
+	double c, s, z;
+	for (std::size_t i{}; i < 50; ++i)
+	{
+		z = _alpha * x * x;
+		stumpff(z, c, s);
+		double x2 = x * x;
+		double f = _sigma * x2 * c + (1 - _alpha * _r0) * x2 * x * s + _r0 * x - sqrt_mu * dt;
+		double df = _sigma * x * (1 - z * s) + (1 - _alpha * _r0) * x2 * c + _r0;
+		double delta = f / df;
+		x -= delta;
+		if (std::abs(delta) <= 1e-15 * std::abs(x))
+			break;
+	}
+	z = _alpha * x * x;
+	stumpff(z, c, s);
+	double x2 = x * x;
+	// функции Лагранжа
+	double f = 1 - x2 / _r0 * c;
+	double g = dt - x2 * x / sqrt_mu * s;
+	double len{};
+	for (std::size_t i{}; i < 3; ++i)
+	{
+		r[i] = f * _r[i] + g * _v[i];
+		len += sqr(r[i]);
+	}
+	len = std::sqrt(len);
+	double df = sqrt_mu / (len * _r0) * x * (z * s - 1);
+	double dg = 1 - x2 / len * c;
+	for (std::size_t i{}; i < 3; ++i)
+	{
+		v[i] = df * _r[i] + dg * _v[i];
+	}
+}
@@ -1,7 +1,18 @@
 #include <ball.hpp>
+#include <gptkernel.hpp>
 #include <maths.hpp>
+#include <simd.hpp>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <stdexcept>
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#endif
 
 using namespace math;
 
@@ -67,182 +78,309 @@ double height_above_ellipsoid(const double *v, double r, double f)
 	return dist - r * (1 - f * sqr(v[2] / dist));
 }
 
-/**
- * @brief Вычисление гармоник синусов и косинусов долготы.
- */
-void calc_trigonometric(double cos, double sin, trigonometric_func *cs, size_t count)
+struct legendre_coefficients
 {
-	cs[0].cos = 1;
-	cs[0].sin = 0;
-	for (size_t i{1}; i <= count; ++i)
-	{
-		cs[i].cos = cs[i - 1].cos * cos - cs[i - 1].sin * sin;
-		cs[i].sin = cs[i - 1].sin * cos + cs[i - 1].cos * sin;
-	}
-}
+	/**
+	 * @brief Множители, упорядоченные так же, как и гармоники геопотенциала
+	 */
+	std::vector<legendre_factors> factors;
 
-/**
- * @brief Вычисление значений полиномов Лежандра.
- */
-void calc_polynomials(double cos, double sin, double *pnm, size_t count)
+	explicit legendre_coefficients(size_t count);
+
+	/**
+	 * @brief Возвращает таблицу для заданной степени. Таблица строится один раз и разделяется между всеми потребителями.
+	 *
+	 * @param count степень разложения
+	 */
+	static std::shared_ptr<legendre_coefficients const> get(size_t count);
+};
+
+legendre_coefficients::legendre_coefficients(size_t count)
 {
-	double const sqrt3 = std::sqrt(3);
-	pnm[0] = 1;
-	pnm[1] = sin * sqrt3;
-	pnm[2] = cos * sqrt3;
-	for (size_t n{2}, k{3}; n <= count; ++n)
+	// дополнительные элементы с нулевыми множителями (для степеней 0 и 1)
+	factors.resize(egm::harmonics_count(count) + 2);
+	for (size_t n{}, k{}; n <= count; ++n)
 	{
-		for (size_t m{}; m < n; ++m, ++k)
+		for (size_t m{}; m <= n; ++m, ++k)
 		{
-			pnm[k] = std::sqrt(2 * n - 1) * sin * pnm[k - n] - std::sqrt((n - 1 - m) * (n - 1 + m) / (2. * n - 3)) * pnm[(k + 1) - n - n];
-			pnm[k] *= std::sqrt((2. * n + 1) / ((n - m) * (n + m)));
+			factors[k] = gpt_detail::make_legendre_factors(n, m);
 		}
-		pnm[k++] = std::sqrt(1 + 0.5 / n) * cos * pnm[k - n - 1];
 	}
 }
 
-geopotential::geopotential() : geopotential(egm::count)
+std::shared_ptr<legendre_coefficients const> legendre_coefficients::get(size_t count)
 {
+	static std::mutex sync;
+	static std::map<size_t, std::weak_ptr<legendre_coefficients const>> tables;
+	std::lock_guard<std::mutex> lock{sync};
+	auto &table = tables[count];
+	auto ptr = table.lock();
+	if (!ptr)
+	{
+		ptr = std::make_shared<legendre_coefficients const>(count);
+		table = ptr;
+	}
+	return ptr;
 }
 
-geopotential::geopotential(size_t count)
+struct legendre_columns
 {
-	if (egm::harmonics.empty())
+	/**
+	 * @brief Множители рекурсии по степени
+	 */
+	std::vector<column_factors> factors;
+	/**
+	 * @brief Гармоники с множителями производных
+	 */
+	std::vector<column_harmonic> harmonics;
+
+	legendre_columns(potential_harmonic const *h, size_t count);
+};
+
+legendre_columns::legendre_columns(potential_harmonic const *h, size_t count)
+{
+	size_t dim = egm::harmonics_count(count);
+	factors.resize(dim);
+	harmonics.resize(dim);
+	for (size_t m{}, i{}; m <= count; ++m)
 	{
-		throw std::runtime_error("Гармоники геопотенциала не загружены.");
+		for (size_t n{m}; n <= count; ++n, ++i)
+		{
+			auto f = gpt_detail::make_legendre_factors(n, m);
+			auto const &harm = h[n * (n + 1) / 2 + m];
+			factors[i] = {f.a, f.b};
+			harmonics[i] = {harm.cos, harm.sin, f.d, f.e};
+		}
 	}
-	count = std::min(count, egm::count);
-	size_t dim = ((count + 1) * (count + 2)) / 2;
-	_cs.resize(count + 1);
-	_pnm.resize(dim + 2);
-	_pnm[dim] = _pnm[dim + 1] = 0;
 }
 
-void geopotential::move(geopotential &other) noexcept
+single_harmonics::single_harmonics(potential_harmonic const *h, legendre_factors const *f, size_t single, size_t count)
+	: offset{egm::harmonics_count(single)}
 {
-	_cs.swap(other._cs);
-	_pnm.swap(other._pnm);
+	size_t dim = egm::harmonics_count(count) - offset + simd::fpack::size;
+	for (auto *v : {&d, &cos, &sin})
+	{
+		v->resize(dim);
+	}
+	for (size_t k{offset}; k < egm::harmonics_count(count); ++k)
+	{
+		d[k - offset] = float(f[k].d);
+		cos[k - offset] = float(h[k].cos);
+		sin[k - offset] = float(h[k].sin);
+	}
 }
 
-geopotential::geopotential(geopotential &&other) noexcept
+bool gpt_detail::avx2_supported()
 {
-	move(other);
+	static bool const supported = []
+	{
+		if (!avx2_clones)
+		{
+			return false;
+		}
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		int info[4];
+		__cpuid(info, 1);
+		// FMA, OSXSAVE, AVX
+		constexpr int features = (1 << 12) | (1 << 27) | (1 << 28);
+		// состояние регистров YMM сохраняется операционной системой
+		if ((info[2] & features) != features || (_xgetbv(0) & 6) != 6)
+		{
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+		return false;
+#endif
+	}();
+	return supported;
 }
 
-geopotential &geopotential::operator=(geopotential &&other) noexcept
+gpt_workspace::gpt_workspace(size_t count)
 {
-	move(other);
-	return *this;
+	reserve(count);
 }
 
-double geopotential::operator()(const double *v)
+void gpt_workspace::reserve(size_t count, gpt_engine engine)
 {
-	auto x = v[0], y = v[1], z = v[2];
-	double result{0};
-	double xy = std::sqrt(sqr(x) + sqr(y));
-	double r = std::sqrt(sqr(xy) + sqr(z));
-	double sinf{z / r};
-	double cosf{xy / r};
-	double cosl{x / xy};
-	double sinl{y / xy};
-	double R_r{egm::rad / r};
-	double mult{1};
-	size_t k{0};
-	size_t count = _cs.size() - 1;
-	calc_trigonometric(cosl, sinl, _cs.data(), count);
-	calc_polynomials(cosf, sinf, _pnm.data(), count);
-	for (size_t n = 0; n <= count; ++n)
+	if (engine == gpt_engine::streaming)
 	{
-		for (size_t m = 0; m <= n; ++m)
+		if (_cols.size() < 3 * (count + 1))
 		{
-			result += mult * _pnm[k] * (egm::harmonics[k].cos * _cs[m].cos + egm::harmonics[k].sin * _cs[m].sin);
-			k++;
+			_cols.resize(3 * (count + 1));
+		}
+		return;
+	}
+	if (engine == gpt_engine::mixed)
+	{
+		// строка полиномов и гармоники долготы с дополнением на пакет float
+		size_t width = count + 2 + simd::fpack::size;
+		if (_float.size() < 3 * width)
+		{
+			_float.resize(3 * width);
 		}
-		mult *= R_r;
 	}
-	return egm::mu / r * result;
+	size_t dim = ((count + 1) * (count + 2)) / 2;
+	if (_cs.size() < count + 1)
+	{
+		_cs.resize(count + 1);
+	}
+	if (_pnm.size() < dim + 2)
+	{
+		_pnm.resize(dim + 2);
+	}
 }
 
-constexpr inline double delta(size_t m) noexcept
+/**
+ * @brief Рабочие буферы текущего потока.
+ */
+gpt_workspace &thread_workspace(size_t count, gpt_engine engine = gpt_engine::spherical)
 {
-	return m == 0 ? 0.5 : 1.0;
+	thread_local gpt_workspace ws;
+	ws.reserve(count, engine);
+	return ws;
 }
-double dpnm(double pnm, double pnm1, size_t n, size_t m, double tanf) noexcept
+
+geopotential::geopotential() : geopotential(egm::count)
 {
-	double out = -pnm * tanf * m;
-	if (m < n)
-		out += pnm1 * std::sqrt(delta(m) * (n + m + 1) * (n - m));
-	return out;
 }
 
-double ddpnm(double pnm, double pnm1, double pnm2, std::size_t n, std::size_t m, double tanf, double cosf)
+gravity_model::gravity_model(std::string name, std::vector<potential_harmonic> harmonics) : _name{std::move(name)}
 {
-	double out = m * (sqr(tanf) * m - 1 / sqr(cosf)) * pnm;
-	if (m < n)
+	if (harmonics.empty())
 	{
-		double mul = (n - m) * (n + m + 1) * delta(m);
-		out -= pnm1 * std::sqrt(mul) * (m + m + 1) * tanf;
-		if (m < n - 1)
-			out += pnm2 * std::sqrt(mul * (n + m + 2) * (n - m - 1));
+		throw std::runtime_error("Модель " + _name + " не содержит гармоник.");
 	}
-	return out;
+	_degree = egm::harmonics_degree(harmonics.size());
+	harmonics.resize(egm::harmonics_count(_degree));
+	auto storage = std::make_shared<std::vector<potential_harmonic> const>(std::move(harmonics));
+	_data = storage->data();
+	_storage = std::move(storage);
 }
 
-void geopotential::diffbyxyz(const double *in, double *out)
+gravity_model::gravity_model(std::string name, std::shared_ptr<void const> storage, potential_harmonic const *data, size_t degree)
+	: _name{std::move(name)}, _storage{std::move(storage)}, _data{data}, _degree{degree}
 {
-	double x = in[0], y = in[1], z = in[2];
-	double xy = std::sqrt(sqr(x) + sqr(y));
-	double r = std::sqrt(sqr(xy) + sqr(z));
-	double sinf{z / r};
-	double cosf{xy / r};
-	double tanf{sinf / cosf};
-	double cosl{x / xy};
-	double sinl{y / xy};
-	double mu_r2{egm::mu / (r * r)};
+}
+
+/**
+ * @brief Модель из начального участка egm::harmonics до заданной степени.
+ */
+gravity_handle global_model(size_t count)
+{
+	if (egm::harmonics.empty())
+	{
+		throw std::runtime_error("Гармоники геопотенциала не загружены.");
+	}
+	count = std::min(count, egm::harmonics_degree(egm::harmonics.size()));
+	auto begin = egm::harmonics.begin();
+	return std::make_shared<gravity_model const>("egm", std::vector<potential_harmonic>(begin, begin + egm::harmonics_count(count)));
+}
+
+geopotential::geopotential(size_t count, gpt_engine engine, double tolerance, size_t single)
+	: geopotential(global_model(count), count, engine, tolerance, single)
+{
+}
+
+geopotential::geopotential(gravity_handle model, size_t count, gpt_engine engine, double tolerance, size_t single)
+	: _model{std::move(model)}, _engine{engine}, _tolerance{tolerance}, _single{single}
+{
+	if (!_model)
+	{
+		throw std::runtime_error("Не задана модель гравитационного поля.");
+	}
+	if (tolerance < 0)
+	{
+		throw std::invalid_argument("Допустимая погрешность ускорения должна быть неотрицательной.");
+	}
+	_count = std::min(count, _model->degree());
+	_coefs = legendre_coefficients::get(_count);
+	if (_engine == gpt_engine::streaming)
+	{
+		_columns = std::make_shared<legendre_columns const>(_model->data(), _count);
+	}
+	if (_engine == gpt_engine::mixed)
+	{
+		if (_single < 2)
+		{
+			throw std::invalid_argument("Степень перехода к одинарной точности должна быть не меньше 2.");
+		}
+		// без AVX2 суммирование пакетами float медленнее, чем в двойной точности, и все степени суммируются в double
+		if (_single < _count && gpt_detail::avx2_supported())
+		{
+			_singles = std::make_shared<single_harmonics const>(_model->data(), _coefs->factors.data(), _single, _count);
+		}
+	}
+	if (tolerance > 0)
+	{
+		/**
+		 * По теореме сложения для нормированных сферических функций степени n:
+		 * |G_n| <= sqrt(2n + 1) * s_n, |grad_S G_n| <= sqrt(n(n + 1)(2n + 1)) * s_n, где s_n = sqrt(sum{m} (Cnm^2 + Snm^2)).
+		 * Отсюда |a_n| <= mu / r^2 * (R / r)^n * (2n + 1) * sqrt(n + 1) * s_n.
+		 */
+		auto bounds = std::make_shared<std::vector<double>>(_count + 1);
+		auto const *h = _model->data();
+		for (size_t n{}, k{}; n <= _count; ++n)
+		{
+			double sum{};
+			for (size_t m{}; m <= n; ++m, ++k)
+			{
+				sum += sqr(h[k].cos) + sqr(h[k].sin);
+			}
+			(*bounds)[n] = (2 * n + 1) * std::sqrt((n + 1) * sum);
+		}
+		_bounds = std::move(bounds);
+	}
+}
+
+size_t geopotential::degree(double r) const
+{
+	if (!_bounds)
+	{
+		return _count;
+	}
+	auto const &bounds = *_bounds;
 	double R_r{egm::rad / r};
-	double mult{1};
-	mat3x3 mx{
-		{cosf * cosl, -sinf * cosl, -sinl},
-		{cosf * sinl, -sinf * sinl, cosl},
-		{sinf, cosf, 0}};
-	size_t k{0};
-	size_t count = _cs.size() - 1;
-	vec3 du, dus;
-
-	calc_trigonometric(cosl, sinl, _cs.data(), count);
-	calc_polynomials(cosf, sinf, _pnm.data(), count);
-
-	// calculating the potential acceleration
-	for (size_t n = 0; n <= count; ++n)
-	{
-		du[0] = du[1] = du[2] = 0.0;
-		for (size_t m = 0; m <= n; ++m)
+	// допустимая сумма оценок отброшенных степеней (без множителя mu / r^2)
+	double limit = _tolerance * sqr(r) / egm::mu;
+	double total{}, mult{1};
+	for (size_t n{}; n <= _count; ++n, mult *= R_r)
+	{
+		total += bounds[n] * mult;
+	}
+	double sum{};
+	mult = 1;
+	for (size_t n{}; n < _count; ++n, mult *= R_r)
+	{
+		sum += bounds[n] * mult;
+		if (total - sum <= limit)
 		{
-			auto poly = _pnm[k];
-			// Cnm * cos(r * L) + Snm * sin(r * L)
-			auto kcs = egm::harmonics[k].cos * _cs[m].cos + egm::harmonics[k].sin * _cs[m].sin;
-			// Snm * cos(r * L) - Cnm * sin(r * L)
-			auto ksc = egm::harmonics[k].sin * _cs[m].cos - egm::harmonics[k].cos * _cs[m].sin;
-			// производная по радиусу-вектору
-			du[0] -= poly * kcs;
-			// производная по широте
-			du[1] += dpnm(_pnm[k], _pnm[k + 1], n, m, tanf) * kcs;
-			// производная по долготе
-			du[2] += poly * ksc * m;
-			++k;
+			return n;
 		}
-		dus[0] += (n + 1) * mult * du[0];
-		dus[1] += mult * du[1];
-		dus[2] += mult * du[2];
-		mult *= R_r;
 	}
-	dus[2] /= cosf;
-	dus *= mu_r2;
-	dus = mx * dus;
+	return _count;
+}
 
-	for (size_t i{}; i < 3; ++i)
-		out[i] = dus[i];
+/**
+ * @brief Производная полинома Лежандра по широте.
+ */
+inline double dpnm(double pnm, double pnm1, size_t m, double tanf, legendre_factors const &f) noexcept
+{
+	return pnm1 * f.d - pnm * tanf * m;
 }
+
+/**
+ * @brief Вторая производная полинома Лежандра по широте.
+ */
+inline double ddpnm(double pnm, double pnm1, double pnm2, size_t m, double tanf, double cosf, legendre_factors const &f) noexcept
+{
+	return m * (sqr(tanf) * m - 1 / sqr(cosf)) * pnm - pnm1 * f.d * (m + m + 1) * tanf + pnm2 * f.e;
+}
+
 /**
  * @brief Вычисление матрицы производных сферических координат по декартовым координатам.
  *
@@ -305,7 +443,7 @@ mat3x3 longitude_deriv(double rcosf, double cosl, double sinl)
 	// ddl/ddy
 	m[1][1] = -m[0][0];
 	// ddl/dxdy
-	m[0][1] = m[1][0] = (sqr(cosl) - sqr(sinl)) / rcosf_sqr;
+	m[0][1] = m[1][0] = (sqr(sinl) - sqr(cosl)) / rcosf_sqr;
 	return m;
 }
 /**
@@ -333,115 +471,241 @@ mat3x3 latitude_deriv(double r, double cosf, double sinf, double tanf, double co
 	return m;
 }
 
-void geopotential::ddiffbyxyz(double const in[3], double outv[3], double outm[3][3])
+template <gpt_order order>
+void geopotential::evaluate_spherical(double const in[3], gpt_values &out, gpt_workspace &ws) const
 {
+	constexpr bool grad = order >= gpt_order::gradient;
+	constexpr bool hess = order >= gpt_order::hessian;
 	double x = in[0], y = in[1], z = in[2];
 	double xy = std::sqrt(sqr(x) + sqr(y));
 	double r = std::sqrt(sqr(xy) + sqr(z));
 	double sinf{z / r}, cosf{xy / r}, tanf{sinf / cosf};
 	double cosl{x / xy}, sinl{y / xy};
 	double _r{1 / r};
-	double _rsqr = sqr(_r);
 	double R_r{egm::rad / r};
 	double mult{1};
-	// матрица производных сферических координат по декартовым координатам
-	const mat3x3 drfl = coordinates_deriv(r, cosf, sinf, cosl, sinl);
-	// транспонированная матрица
-	const mat3x3 drfl_t = transpose(drfl);
-	// матрица вторых производных радиуса-вектора
-	const mat3x3 ddr = radius_deriv(r, drfl[0][0], drfl[0][1], drfl[0][2]);
-	// матрица вторых производных широты
-	const mat3x3 ddf = latitude_deriv(r, cosf, sinf, tanf, cosl, sinl);
-	// матрица вторых производных долготы
-	const mat3x3 ddl = longitude_deriv(xy, cosl, sinl);
-	// вектор производных потенциала по координатам
+	// значение потенциала
+	double u{};
+	// вектор производных потенциала по сферическим координатам (r, f, l)
 	vec3 du;
-	// матрицы вторых производных по координатам
+	// матрица вторых производных по сферическим координатам
 	mat3x3 ddu;
 	// старшая гармоника
-	size_t count = _cs.size() - 1;
+	size_t count = degree(r);
+	// старшая гармоника, суммируемая в двойной точности
+	size_t last = count;
+	if constexpr (!hess)
+	{
+		if (_singles)
+		{
+			last = std::min(count, _single);
+		}
+	}
+	auto const *f = _coefs->factors.data();
+	auto const *h = _model->data();
 
-	calc_trigonometric(cosl, sinl, _cs.data(), count);
-	calc_polynomials(cosf, sinf, _pnm.data(), count);
+	gpt_detail::calc_trigonometric(cosl, sinl, ws._cs.data(), count);
+	gpt_detail::calc_polynomials(cosf, sinf, ws._pnm.data(), f, count);
 
-	for (size_t n{}, k{}; n <= count; ++n)
+	for (size_t n{}, k{}; n <= last; ++n)
 	{
 		double dudr{}, dudf{}, dudl{};
-		double ddudrdr{}, ddudfdf{}, ddudldl{}, ddudrdf{}, ddudrdl{}, ddudfdl{};
-		// Rn(r) = (R / r)^n / r
-		double Rn = mult * _r;
-		// dRn(r) = (R / r)^n * -(n + 1) / r
-		double dRn = -Rn * (n + 1) * _r;
-		// ddRn(r) = (R / r)^n * (n + 1) * (n + 2)
-		double ddRn = -dRn * (n + 2) * _r;
+		double ddudfdf{}, ddudldl{}, ddudfdl{};
 		for (size_t m{}; m <= n; ++m, ++k)
 		{
-			double cnm = egm::harmonics[k].cos;
-			double snm = egm::harmonics[k].sin;
-			double cosml = _cs[m].cos;
-			double sinml = _cs[m].sin;
+			double cnm = h[k].cos;
+			double snm = h[k].sin;
+			double cosml = ws._cs[m].cos;
+			double sinml = ws._cs[m].sin;
 			// Lnm(l) = Cnm * cos(ml) + Snm * sin(ml)
 			double Lnm = cnm * cosml + snm * sinml;
-			// dLnm(l)/dl = m * (Snm * cos(ml) - Cnm * sin(ml))
-			double dLnm = m * (snm * cosml - cnm * sinml);
-			// ddLnm(l)/ddl = -m * m * Lnm(l)
-			double ddLnm = m * m * -Lnm;
 			// Fnm(f) = Pnm(sin(f))
-			double Fnm = _pnm[k];
-			// dFnm(f) = dPnm(sin(f))/df
-			double dFnm = dpnm(Fnm, _pnm[k + 1], n, m, tanf);
-			// ddFnm(f) = ddPnm(sin(f))/ddf
-			double ddFnm = ddpnm(Fnm, _pnm[k + 1], _pnm[k + 2], n, m, tanf, cosf);
-			ddudrdr = dudr += Fnm * Lnm;
-			ddudrdf = dudf += dFnm * Lnm;
-			ddudrdl = dudl += Fnm * dLnm;
-			ddudfdf += ddFnm * Lnm;
-			ddudldl += Fnm * ddLnm;
-			ddudfdl += dFnm * dLnm;
+			double Fnm = ws._pnm[k];
+			dudr += Fnm * Lnm;
+			if constexpr (grad)
+			{
+				// dLnm(l)/dl = m * (Snm * cos(ml) - Cnm * sin(ml))
+				double dLnm = m * (snm * cosml - cnm * sinml);
+				// dFnm(f) = dPnm(sin(f))/df
+				double dFnm = dpnm(Fnm, ws._pnm[k + 1], m, tanf, f[k]);
+				dudf += dFnm * Lnm;
+				dudl += Fnm * dLnm;
+				if constexpr (hess)
+				{
+					// ddLnm(l)/ddl = -m * m * Lnm(l)
+					double ddLnm = m * m * -Lnm;
+					// ddFnm(f) = ddPnm(sin(f))/ddf
+					double ddFnm = ddpnm(Fnm, ws._pnm[k + 1], ws._pnm[k + 2], m, tanf, cosf, f[k]);
+					ddudfdf += ddFnm * Lnm;
+					ddudldl += Fnm * ddLnm;
+					ddudfdl += dFnm * dLnm;
+				}
+			}
+		}
+		// Rn(r) = (R / r)^n / r
+		double Rn = mult * _r;
+		u += dudr * Rn;
+		if constexpr (grad)
+		{
+			// dRn(r) = (R / r)^n * -(n + 1) / r
+			double dRn = -Rn * (n + 1) * _r;
+			du[0] += dudr * dRn;
+			du[1] += dudf * Rn;
+			du[2] += dudl * Rn;
+			if constexpr (hess)
+			{
+				// ddRn(r) = (R / r)^n * (n + 1) * (n + 2)
+				double ddRn = -dRn * (n + 2) * _r;
+				ddu[0][0] += dudr * ddRn;
+				ddu[0][1] += dudf * dRn;
+				ddu[0][2] += dudl * dRn;
+				ddu[1][1] += ddudfdf * Rn;
+				ddu[2][2] += ddudldl * Rn;
+				ddu[1][2] += ddudfdl * Rn;
+			}
 		}
-		du[0] += dudr * dRn;
-		du[1] += dudf * Rn;
-		du[2] += dudl * Rn;
-		ddu[0][0] += ddudrdr * ddRn;
-		ddu[0][1] += ddudrdf * dRn;
-		ddu[0][2] += ddudrdl * dRn;
-		ddu[1][1] += ddudfdf * Rn;
-		ddu[2][2] += ddudldl * Rn;
-		ddu[1][2] += ddudfdl * Rn;
 		mult *= R_r;
 	}
-	// умножаем на постоянную часть
-	// du[0] *= _rsqr;
-	// du[1] *= _r;
-	// du[2] *= _r;
-	// ddu[0][0] *= _rsqr * _r;
-	// ddu[0][1] *= _rsqr;
-	// ddu[0][2] *= _rsqr;
-	// ddu[1][1] *= _r;
-	// ddu[2][2] *= _r;
-	// ddu[1][2] *= _r;
+	if constexpr (!hess)
+	{
+		if (last < count)
+		{
+			evaluate_single<grad>(last + 1, count, cosf, sinf, _r, mult, u, du.data(), ws);
+		}
+	}
 	// умножаем на гравитационный множитель
-	du *= egm::mu;
-	ddu *= egm::mu;
-	// дозаполняем матрицу вторых производных
-	ddu[1][0] = ddu[0][1];
-	ddu[2][0] = ddu[0][2];
-	ddu[2][1] = ddu[1][2];
-	// перевод к системе координат x, y, z
-	ddu = drfl_t * ddu * drfl + ddr * du[0] + ddf * du[1] + ddl * du[2];
-	du = drfl_t * du;
-
-	for (std::size_t r{}; r < 3; ++r)
-	{
-		outv[r] = du[r];
-		for (std::size_t c{}; c < 3; ++c)
+	out.u = u * egm::mu;
+	if constexpr (grad)
+	{
+		du *= egm::mu;
+		// матрица производных сферических координат по декартовым координатам
+		const mat3x3 drfl = coordinates_deriv(r, cosf, sinf, cosl, sinl);
+		// транспонированная матрица
+		const mat3x3 drfl_t = transpose(drfl);
+		if constexpr (hess)
 		{
-			outm[r][c] = ddu[r][c];
+			// матрица вторых производных радиуса-вектора
+			const mat3x3 ddr = radius_deriv(r, drfl[0][0], drfl[0][1], drfl[0][2]);
+			// матрица вторых производных широты
+			const mat3x3 ddf = latitude_deriv(r, cosf, sinf, tanf, cosl, sinl);
+			// матрица вторых производных долготы
+			const mat3x3 ddl = longitude_deriv(xy, cosl, sinl);
+			ddu *= egm::mu;
+			// дозаполняем матрицу вторых производных
+			ddu[1][0] = ddu[0][1];
+			ddu[2][0] = ddu[0][2];
+			ddu[2][1] = ddu[1][2];
+			// перевод к системе координат x, y, z
+			ddu = drfl_t * ddu * drfl + ddr * du[0] + ddf * du[1] + ddl * du[2];
+			std::memcpy(out.ddu, ddu.data(), sizeof(ddu));
 		}
+		du = drfl_t * du;
+		std::memcpy(out.du, du.data(), sizeof(du));
+	}
+}
+
+template <gpt_order order>
+void geopotential::evaluate_cartesian(double const in[3], gpt_values &out, gpt_workspace &ws) const
+{
+	double r = std::sqrt(sqr(in[0]) + sqr(in[1]) + sqr(in[2]));
+	gpt_detail::evaluate_pines<order>(in, out, degree(r), _coefs->factors.data(), _model->data(), ws._cs.data(), ws._pnm.data());
+}
+
+template <gpt_order order>
+void geopotential::evaluate_streaming(double const in[3], gpt_values &out, gpt_workspace &ws) const
+{
+	double r = std::sqrt(sqr(in[0]) + sqr(in[1]) + sqr(in[2]));
+	gpt_detail::evaluate_streaming<order>(in, out, degree(r), _count, _columns->factors.data(), _columns->harmonics.data(), ws._cols.data());
+}
+
+template <gpt_order order>
+void geopotential::evaluate(double const in[3], gpt_values &out, gpt_workspace &ws) const
+{
+	ws.reserve(_count, _engine);
+	switch (_engine)
+	{
+	case gpt_engine::cartesian:
+		evaluate_cartesian<order>(in, out, ws);
+		break;
+	case gpt_engine::streaming:
+		evaluate_streaming<order>(in, out, ws);
+		break;
+	default:
+		evaluate_spherical<order>(in, out, ws);
+	}
+}
+
+template <gpt_order order>
+void geopotential::evaluate(double const in[3], gpt_values &out) const
+{
+	evaluate<order>(in, out, thread_workspace(_count, _engine));
+}
+
+template void geopotential::evaluate<gpt_order::value>(double const[3], gpt_values &, gpt_workspace &) const;
+template void geopotential::evaluate<gpt_order::value>(double const[3], gpt_values &) const;
+template void geopotential::evaluate<gpt_order::gradient>(double const[3], gpt_values &, gpt_workspace &) const;
+template void geopotential::evaluate<gpt_order::gradient>(double const[3], gpt_values &) const;
+template void geopotential::evaluate<gpt_order::hessian>(double const[3], gpt_values &, gpt_workspace &) const;
+template void geopotential::evaluate<gpt_order::hessian>(double const[3], gpt_values &) const;
+
+double geopotential::operator()(const double *v) const
+{
+	gpt_values out;
+	evaluate<gpt_order::value>(v, out);
+	return out.u;
+}
+
+void geopotential::diffbyxyz(const double *in, double *out) const
+{
+	gpt_values values;
+	evaluate<gpt_order::gradient>(in, values);
+	std::memcpy(out, values.du, sizeof(values.du));
+}
+
+void geopotential::ddiffbyxyz(double const in[3], double outv[3], double outm[3][3]) const
+{
+	gpt_values values;
+	evaluate<gpt_order::hessian>(in, values);
+	std::memcpy(outv, values.du, sizeof(values.du));
+	std::memcpy(outm, values.ddu, sizeof(values.ddu));
+}
+
+void geopotential::diffbyxyz(size_t count, double const *x, double const *y, double const *z, double *ax, double *ay, double *az) const
+{
+	if (gpt_detail::avx2_supported())
+	{
+		gpt_detail::diffbyxyz_avx2(count, x, y, z, ax, ay, az, _coefs->factors.data(), _model->data(), _count,
+								   [](void const *gpt, double r)
+								   { return static_cast<geopotential const *>(gpt)->degree(r); },
+								   this);
+		return;
+	}
+	using simd::dpack;
+	constexpr size_t lanes = dpack::size;
+	size_t degree = _count;
+	// буфер потока только увеличивается, поэтому при повторных вызовах память не выделяется
+	thread_local std::vector<dpack> buf;
+	if (buf.size() < 2 * (degree + 1) + 2 * (degree + 2))
+	{
+		buf.resize(2 * (degree + 1) + 2 * (degree + 2));
 	}
+	dpack *cs = buf.data(), *sn = cs + degree + 1;
+	dpack *prev = sn + degree + 1, *curr = prev + degree + 2;
+	gpt_detail::diffbyxyz_packs(count, x, y, z, ax, ay, az,
+								[&](dpack const in[3], dpack out[3], size_t i)
+								{
+									// степень разложения для пакета определяется ближайшей к центру точкой
+									double rmin = std::numeric_limits<double>::max();
+									for (size_t j{i}; j < std::min(i + lanes, count); ++j)
+									{
+										rmin = std::min(rmin, sqr(x[j]) + sqr(y[j]) + sqr(z[j]));
+									}
+									gpt_detail::diffbyxyz_pack(in, out, _coefs->factors.data(), _model->data(), this->degree(std::sqrt(rmin)),
+															   cs, sn, prev, curr);
+								});
 }
 
-void geopotential::diffbysph(double const in[3], double out[3])
+void geopotential::diffbysph(double const in[3], double out[3]) const
 {
 	double sinf = std::sin(in[1]), cosf = std::cos(in[1]), tanf{sinf / cosf};
 	double sinl = std::sin(in[2]), cosl = std::cos(in[2]);
@@ -452,9 +716,11 @@ void geopotential::diffbysph(double const in[3], double out[3])
 	// вектор производных потенциала
 	vec3 du;
 	// старшая гармоника
-	size_t count = _cs.size() - 1;
-	calc_trigonometric(cosl, sinl, _cs.data(), count);
-	calc_polynomials(cosf, sinf, _pnm.data(), count);
+	size_t count = degree(in[0]);
+	auto const *h = _model->data();
+	auto &ws = thread_workspace(count);
+	gpt_detail::calc_trigonometric(cosl, sinl, ws._cs.data(), count);
+	gpt_detail::calc_polynomials(cosf, sinf, ws._pnm.data(), _coefs->factors.data(), count);
 	for (size_t k{}, n{}; n <= count; ++n)
 	{
 		double dudr{}, dudf{}, dudl{};
@@ -464,19 +730,19 @@ void geopotential::diffbysph(double const in[3], double out[3])
 		double dRn = -Rn * (n + 1);
 		for (size_t m{}; m <= n; ++m, ++k)
 		{
-			double poly = _pnm[k];
-			double cnm = egm::harmonics[k].cos;
-			double snm = egm::harmonics[k].sin;
-			double cosml = _cs[m].cos;
-			double sinml = _cs[m].sin;
+			double poly = ws._pnm[k];
+			double cnm = h[k].cos;
+			double snm = h[k].sin;
+			double cosml = ws._cs[m].cos;
+			double sinml = ws._cs[m].sin;
 			// Lnm(l) = Cnm * cos(ml) + Snm * sin(ml)
 			double Lnm = cnm * cosml + snm * sinml;
 			// dLnm(l)/dl = m * (Snm * cos(ml) - Cnm * sin(ml))
 			double dLnm = m * (snm * cosml - cnm * sinml);
 			// Fnm(f) = Pnm(sin(f))
-			double Fnm = _pnm[k];
+			double Fnm = ws._pnm[k];
 			// dFnm(f) = dPnm(sin(f))/df
-			double dFnm = dpnm(Fnm, _pnm[k + 1], n, m, tanf);
+			double dFnm = dpnm(Fnm, ws._pnm[k + 1], m, tanf, _coefs->factors[k]);
 			dudr += Fnm * Lnm;
 			dudf += dFnm * Lnm;
 			dudl += Fnm * dLnm;
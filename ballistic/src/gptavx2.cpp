@@ -0,0 +1,121 @@
+#include <ball.hpp>
+#include <gptkernel.hpp>
+#include <simd.hpp>
+#include <cmath>
+#include <vector>
+
+/**
+ * Копии пакетных ядер геопотенциала. При BALLISTIC_AVX2 единица трансляции собирается с AVX2/FMA, и её функции
+ * вызываются только после проверки процессора (gpt_detail::avx2_supported). Здесь создаются только функции, типы
+ * которых содержат пакеты AVX2 (встроенное пространство имён avx2), и простые методы доступа: встраиваемые функции
+ * общих заголовков, созданные с AVX2, при компоновке могли бы заменить их варианты для базового набора инструкций.
+ */
+
+#ifdef BALLISTIC_AVX2
+bool const gpt_detail::avx2_clones{true};
+#else
+bool const gpt_detail::avx2_clones{false};
+#endif
+
+void gpt_detail::diffbyxyz_avx2(size_t count, double const *x, double const *y, double const *z, double *ax, double *ay, double *az,
+								legendre_factors const *f, potential_harmonic const *h, size_t degree,
+								pack_degree adapt, void const *context)
+{
+	using math::simd::dpack;
+	constexpr size_t lanes = dpack::size;
+	// буфер потока только увеличивается, поэтому при повторных вызовах память не выделяется
+	thread_local std::vector<dpack> buf;
+	if (buf.size() < 2 * (degree + 1) + 2 * (degree + 2))
+	{
+		buf.resize(2 * (degree + 1) + 2 * (degree + 2));
+	}
+	dpack *cs = buf.data(), *sn = cs + degree + 1;
+	dpack *prev = sn + degree + 1, *curr = prev + degree + 2;
+	diffbyxyz_packs(count, x, y, z, ax, ay, az,
+					[&](dpack const in[3], dpack out[3], size_t i)
+					{
+						size_t n = degree;
+						if (adapt)
+						{
+							// степень разложения для пакета определяется ближайшей к центру точкой
+							double rmin = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+							for (size_t j{i + 1}; j < i + lanes && j < count; ++j)
+							{
+								double r = x[j] * x[j] + y[j] * y[j] + z[j] * z[j];
+								rmin = r < rmin ? r : rmin;
+							}
+							n = adapt(context, std::sqrt(rmin));
+						}
+						diffbyxyz_pack(in, out, f, h, n, cs, sn, prev, curr);
+					});
+}
+
+/**
+ * Степени first..count суммируются пакетами float по порядку m, сумма строки добавляется к сумме в double.
+ * Полиномы Лежандра вычисляются в двойной точности и преобразуются в float построчно: в рекурсии по степени
+ * малые секториальные значения (порядка cos^m) вне диапазона float усиливаются до величин порядка единицы.
+ * Используется, только если avx2_supported(): без AVX2 пакеты float медленнее суммирования в double.
+ */
+template <bool grad>
+void geopotential::evaluate_single(size_t first, size_t count, double cosf, double sinf, double _r, double mult,
+								   double &u, double du[3], gpt_workspace &ws) const
+{
+	using math::simd::fpack;
+	constexpr size_t lanes = fpack::size;
+	auto const &t = *_singles;
+	double R_r{egm::rad * _r};
+	size_t width = count + 2 + lanes;
+	float *row = ws._float.data(), *cosm = row + width, *sinm = cosm + width;
+	for (size_t m{}; m < width; ++m)
+	{
+		cosm[m] = m <= count ? float(ws._cs[m].cos) : 0.f;
+		sinm[m] = m <= count ? float(ws._cs[m].sin) : 0.f;
+	}
+	fpack const zero = fpack::broadcast(0);
+	fpack const tanp = fpack::broadcast(float(sinf / cosf));
+	// индекс первой гармоники степени n
+	for (size_t n{first}, k{first * (first + 1) / 2}; n <= count; k += n + 1, ++n)
+	{
+		float const *d = t.d.data() + (k - t.offset);
+		float const *c = t.cos.data() + (k - t.offset), *s = t.sin.data() + (k - t.offset);
+		// строка полиномов в float, за строкой - нули (к ним обращается производная)
+		double const *pnm = ws._pnm.data() + k;
+		for (size_t m{}; m <= n + lanes; ++m)
+		{
+			row[m] = m <= n ? float(pnm[m]) : 0.f;
+		}
+		fpack dudr = zero, dudf = zero, dudl = zero;
+		for (size_t m{}; m <= n; m += lanes)
+		{
+			fpack poly = fpack::load(row + m);
+			fpack cnm = fpack::load(c + m), snm = fpack::load(s + m);
+			fpack cosml = fpack::load(cosm + m), sinml = fpack::load(sinm + m);
+			// Cnm * cos(ml) + Snm * sin(ml)
+			fpack lnm = fma(cnm, cosml, snm * sinml);
+			dudr = fma(poly, lnm, dudr);
+			if constexpr (grad)
+			{
+				fpack mm = fpack::ramp(float(m));
+				// m * (Snm * cos(ml) - Cnm * sin(ml))
+				fpack dlnm = mm * fnma(cnm, sinml, snm * cosml);
+				// производная полинома по широте
+				fpack dpoly = fnma(tanp * mm, poly, fpack::load(d + m) * fpack::load(row + m + 1));
+				dudf = fma(dpoly, lnm, dudf);
+				dudl = fma(poly, dlnm, dudl);
+			}
+		}
+		double Rn = mult * _r;
+		double sum = dudr.sum();
+		u += sum * Rn;
+		if constexpr (grad)
+		{
+			du[0] -= sum * Rn * (n + 1) * _r;
+			du[1] += dudf.sum() * Rn;
+			du[2] += dudl.sum() * Rn;
+		}
+		mult *= R_r;
+	}
+}
+
+template void geopotential::evaluate_single<false>(size_t, size_t, double, double, double, double, double &, double[3], gpt_workspace &) const;
+template void geopotential::evaluate_single<true>(size_t, size_t, double, double, double, double, double &, double[3], gpt_workspace &) const;
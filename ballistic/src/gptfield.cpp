@@ -0,0 +1,261 @@
+#include <gptfield.hpp>
+#include <maths.hpp>
+#include <parallel.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace math;
+
+namespace
+{
+	/**
+	 * @brief Кол-во узлов блока по широте и долготе
+	 */
+	constexpr size_t tile_size{16};
+	/**
+	 * @brief Наибольшее кол-во узлов по широте
+	 */
+	constexpr size_t max_nodes{4097};
+	/**
+	 * @brief Кол-во контрольных точек при подборе шага сетки
+	 */
+	constexpr size_t test_count{64};
+
+	/**
+	 * @brief Веса кубической интерполяции Лагранжа по узлам 0, 1, 2, 3 в точке x (в единицах шага)
+	 */
+	void cubic_weights(double x, double w[4])
+	{
+		double x0 = x, x1 = x - 1, x2 = x - 2, x3 = x - 3;
+		w[0] = -x1 * x2 * x3 / 6;
+		w[1] = x0 * x2 * x3 / 2;
+		w[2] = -x0 * x1 * x3 / 2;
+		w[3] = x0 * x1 * x2 / 6;
+	}
+
+	/**
+	 * @brief Первый узел шаблона из 4-х узлов, ограниченный диапазоном [0, count - 4]
+	 */
+	size_t stencil_begin(double t, size_t count)
+	{
+		double begin = std::floor(t) - 1;
+		return static_cast<size_t>(std::clamp(begin, 0.0, double(count - 4)));
+	}
+
+	/**
+	 * @brief Центральная часть ускорения
+	 */
+	void central_acceleration(double const in[3], double r, double out[3])
+	{
+		double mult = -egm::mu / cube(r);
+		for (size_t i{}; i < 3; ++i)
+		{
+			out[i] = in[i] * mult;
+		}
+	}
+}
+
+gpt_field::gpt_field(geopotential const &gpt, double rmin, double rmax, double tolerance, size_t max_bytes)
+	: _gpt{gpt.model(), gpt.count(), gpt_engine::cartesian}, _rmin{rmin}, _rmax{rmax}, _tolerance{tolerance}, _max_bytes{max_bytes}
+{
+	if (rmin <= 0 || rmax <= rmin)
+	{
+		throw std::invalid_argument("Некорректные границы слоя для кэша геопотенциала.");
+	}
+	if (tolerance <= 0)
+	{
+		throw std::invalid_argument("Допустимая погрешность кэша геопотенциала должна быть положительной.");
+	}
+	// начальный шаг - четверть полуволны старшей гармоники
+	size_t nf = std::max<size_t>(9, 4 * _gpt.count() + 1);
+	// запас на случай, если наибольшая погрешность приходится не на контрольные точки
+	for (resize(nf); calibrate() > tolerance / 2; resize(nf))
+	{
+		nf = 2 * (nf - 1) + 1;
+		if (nf > max_nodes)
+		{
+			throw std::invalid_argument("Заданная погрешность кэша геопотенциала недостижима.");
+		}
+	}
+}
+
+void gpt_field::resize(size_t nf)
+{
+	_nf = nf;
+	_hf = pi / (nf - 1);
+	_nl = 2 * (nf - 1);
+	_hl = 2 * pi / _nl;
+	// шаг по расстоянию соответствует угловому шагу на нижней границе слоя
+	_hr = _rmin * _hf;
+	_r0 = _rmin - _hr;
+	_nr = static_cast<size_t>(std::ceil((_rmax - _rmin) / _hr)) + 4;
+	_tf = (_nf + tile_size - 1) / tile_size;
+	_tl = (_nl + tile_size - 1) / tile_size;
+	if (bytes() > _max_bytes)
+	{
+		throw std::invalid_argument("Сетка кэша геопотенциала превышает допустимый объём.");
+	}
+	_tiles.reset(new tile[_tf * _tl]);
+}
+
+void gpt_field::compute_node(size_t ir, size_t jf, size_t jl, double out[3]) const
+{
+	double r = _r0 + ir * _hr;
+	double f = -pi / 2 + jf * _hf;
+	double l = -pi + jl * _hl;
+	double in[3]{r * std::cos(f) * std::cos(l), r * std::cos(f) * std::sin(l), r * std::sin(f)};
+	double central[3];
+	_gpt.diffbyxyz(in, out);
+	central_acceleration(in, r, central);
+	for (size_t i{}; i < 3; ++i)
+	{
+		out[i] -= central[i];
+	}
+}
+
+void gpt_field::build_tile(size_t index) const
+{
+	auto &t = _tiles[index];
+	size_t f0 = (index / _tl) * tile_size;
+	size_t l0 = (index % _tl) * tile_size;
+	t.values.resize(_nr * tile_size * tile_size * 3);
+	par::parallel_for(size_t{}, tile_size * tile_size, [&](size_t column)
+	{
+		size_t jf = f0 + column / tile_size, jl = l0 + column % tile_size;
+		if (jf < _nf && jl < _nl)
+		{
+			for (size_t ir{}; ir < _nr; ++ir)
+			{
+				compute_node(ir, jf, jl, t.values.data() + (ir * tile_size * tile_size + column) * 3);
+			}
+		}
+	});
+}
+
+void gpt_field::prepare(stencil const &s) const
+{
+	// шаблон захватывает не более двух блоков по каждой из осей
+	size_t fs[2]{s.f / tile_size, (s.f + 3) / tile_size};
+	size_t ls[2]{s.l[0] / tile_size, s.l[3] / tile_size};
+	for (size_t f : fs)
+	{
+		for (size_t l : ls)
+		{
+			size_t index = f * _tl + l;
+			std::call_once(_tiles[index].flag, [this, index]
+						   { build_tile(index); });
+		}
+	}
+}
+
+double const *gpt_field::node(size_t ir, size_t jf, size_t jl) const
+{
+	auto const &t = _tiles[(jf / tile_size) * _tl + jl / tile_size];
+	size_t column = (jf % tile_size) * tile_size + jl % tile_size;
+	return t.values.data() + (ir * tile_size * tile_size + column) * 3;
+}
+
+gpt_field::stencil gpt_field::make_stencil(double const in[3], double r) const
+{
+	stencil s;
+	double f = std::atan2(in[2], std::sqrt(sqr(in[0]) + sqr(in[1])));
+	double l = std::atan2(in[1], in[0]);
+	double tr = (r - _r0) / _hr, tf = (f + pi / 2) / _hf, tl = (l + pi) / _hl;
+	s.r = stencil_begin(tr, _nr);
+	s.f = stencil_begin(tf, _nf);
+	// по долготе сетка замкнута
+	double bl = std::floor(tl) - 1;
+	cubic_weights(tr - s.r, s.wr);
+	cubic_weights(tf - s.f, s.wf);
+	cubic_weights(tl - bl, s.wl);
+	for (size_t q{}; q < 4; ++q)
+	{
+		s.l[q] = static_cast<size_t>(bl + double(q + _nl)) % _nl;
+	}
+	return s;
+}
+
+template <typename F>
+void gpt_field::interpolate(double const in[3], double r, stencil const &s, double out[3], F &&node_values) const
+{
+	double acc[3]{};
+	for (size_t a{}; a < 4; ++a)
+	{
+		for (size_t b{}; b < 4; ++b)
+		{
+			double w = s.wr[a] * s.wf[b];
+			for (size_t c{}; c < 4; ++c)
+			{
+				double const *v = node_values(s.r + a, s.f + b, s.l[c]);
+				double wc = w * s.wl[c];
+				acc[0] += wc * v[0];
+				acc[1] += wc * v[1];
+				acc[2] += wc * v[2];
+			}
+		}
+	}
+	central_acceleration(in, r, out);
+	for (size_t i{}; i < 3; ++i)
+	{
+		out[i] += acc[i];
+	}
+}
+
+double gpt_field::calibrate() const
+{
+	double errors[test_count]{};
+	par::parallel_for(size_t{}, test_count, [&](size_t index)
+	{
+		// квазислучайные точки (последовательность Вейля) у нижней границы слоя, где поле наименее гладкое;
+		// значения в узлах вычисляются без построения блоков
+		double r = _rmin + std::min(_rmax - _rmin, 2 * _hr) * std::fmod(0.5 + index * 0.6180339887498949, 1.0);
+		double sinf = 2 * std::fmod(0.5 + index * 0.7548776662466927, 1.0) - 1;
+		double l = 2 * pi * std::fmod(0.5 + index * 0.5698402909980532, 1.0);
+		double cosf = std::sqrt(1 - sqr(sinf));
+		double in[3]{r * cosf * std::cos(l), r * cosf * std::sin(l), r * sinf};
+		double values[64][3];
+		size_t count{};
+		double approx[3], exact[3];
+		interpolate(in, r, make_stencil(in, r), approx, [&](size_t ir, size_t jf, size_t jl)
+		{
+			compute_node(ir, jf, jl, values[count]);
+			return values[count++];
+		});
+		_gpt.diffbyxyz(in, exact);
+		errors[index] = std::sqrt(sqr(approx[0] - exact[0]) + sqr(approx[1] - exact[1]) + sqr(approx[2] - exact[2]));
+	});
+	return *std::max_element(std::begin(errors), std::end(errors));
+}
+
+void gpt_field::build() const
+{
+	// узлы каждого блока вычисляются параллельно
+	for (size_t index{}; index < _tf * _tl; ++index)
+	{
+		auto &t = _tiles[index];
+		std::call_once(t.flag, [this, index]
+					   { build_tile(index); });
+	}
+}
+
+size_t gpt_field::bytes() const
+{
+	return _tf * _tl * tile_size * tile_size * _nr * 3 * sizeof(double);
+}
+
+void gpt_field::diffbyxyz(double const in[3], double out[3]) const
+{
+	double r = std::sqrt(sqr(in[0]) + sqr(in[1]) + sqr(in[2]));
+	if (r < _rmin || r > _rmax)
+	{
+		_gpt.diffbyxyz(in, out);
+	}
+	else
+	{
+		auto s = make_stencil(in, r);
+		prepare(s);
+		interpolate(in, r, s, out, [this](size_t ir, size_t jf, size_t jl)
+					{ return node(ir, jf, jl); });
+	}
+}
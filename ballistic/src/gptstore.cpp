@@ -0,0 +1,306 @@
+#include <gptstore.hpp>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace egm
+{
+	constexpr char harmonics_magic[8]{'G', 'P', 'T', 'H', 'A', 'R', 'M', '\0'};
+	constexpr std::uint32_t harmonics_version{1};
+
+	size_t convert_harmonics(std::string_view textpath, std::string_view binpath)
+	{
+		std::ifstream fin{std::string{textpath}};
+		if (!fin.is_open())
+		{
+			throw std::runtime_error("Не удалось открыть файл " + std::string{textpath});
+		}
+		std::vector<potential_harmonic> data;
+		potential_harmonic h;
+		while (fin >> h.cos >> h.sin)
+		{
+			data.push_back(h);
+		}
+		if (data.empty())
+		{
+			throw std::runtime_error("Файл " + std::string{textpath} + " не содержит гармоник.");
+		}
+		size_t degree = harmonics_degree(data.size());
+		harmonics_header header{};
+		std::memcpy(header.magic, harmonics_magic, sizeof(header.magic));
+		header.version = harmonics_version;
+		header.degree = static_cast<std::uint32_t>(degree);
+		std::ofstream fout{std::string{binpath}, std::ios_base::binary};
+		if (!fout.is_open())
+		{
+			throw std::runtime_error("Не удалось создать файл " + std::string{binpath});
+		}
+		fout.write(reinterpret_cast<char const *>(&header), sizeof(header));
+		fout.write(reinterpret_cast<char const *>(data.data()), harmonics_count(degree) * sizeof(potential_harmonic));
+		if (!fout)
+		{
+			throw std::runtime_error("Ошибка записи в файл " + std::string{binpath});
+		}
+		return degree;
+	}
+
+	/**
+	 * @brief Проверка заголовка и вычисление степени, которую можно отобразить
+	 */
+	size_t verify_header(harmonics_header const &header, size_t filesize, size_t degree, std::string_view path)
+	{
+		if (std::memcmp(header.magic, harmonics_magic, sizeof(header.magic)) != 0 || header.version != harmonics_version)
+		{
+			throw std::runtime_error("Файл " + std::string{path} + " не является двоичным файлом гармоник.");
+		}
+		degree = std::min<size_t>(degree, header.degree);
+		if (filesize < sizeof(harmonics_header) + harmonics_count(degree) * sizeof(potential_harmonic))
+		{
+			throw std::runtime_error("Файл " + std::string{path} + " повреждён.");
+		}
+		return degree;
+	}
+
+#ifdef _WIN32
+	mapped_harmonics::mapped_harmonics(std::string_view path, size_t degree)
+	{
+		HANDLE file = CreateFileA(std::string{path}.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error("Не удалось открыть файл " + std::string{path});
+		}
+		LARGE_INTEGER filesize;
+		GetFileSizeEx(file, &filesize);
+		harmonics_header header{};
+		DWORD read{};
+		ReadFile(file, &header, sizeof(header), &read, nullptr);
+		if (read != sizeof(header))
+		{
+			CloseHandle(file);
+			throw std::runtime_error("Файл " + std::string{path} + " не является двоичным файлом гармоник.");
+		}
+		try
+		{
+			_degree = verify_header(header, static_cast<size_t>(filesize.QuadPart), degree, path);
+		}
+		catch (...)
+		{
+			CloseHandle(file);
+			throw;
+		}
+		_length = sizeof(harmonics_header) + harmonics_count(_degree) * sizeof(potential_harmonic);
+		_handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!_handle)
+		{
+			throw std::runtime_error("Не удалось отобразить в память файл " + std::string{path});
+		}
+		_view = MapViewOfFile(_handle, FILE_MAP_READ, 0, 0, _length);
+		if (!_view)
+		{
+			close();
+			throw std::runtime_error("Не удалось отобразить в память файл " + std::string{path});
+		}
+	}
+
+	void mapped_harmonics::close() noexcept
+	{
+		if (_view)
+		{
+			UnmapViewOfFile(_view);
+		}
+		if (_handle)
+		{
+			CloseHandle(_handle);
+		}
+		_view = _handle = nullptr;
+	}
+#else
+	mapped_harmonics::mapped_harmonics(std::string_view path, size_t degree)
+	{
+		int file = ::open(std::string{path}.c_str(), O_RDONLY);
+		if (file < 0)
+		{
+			throw std::runtime_error("Не удалось открыть файл " + std::string{path});
+		}
+		struct stat info;
+		harmonics_header header{};
+		if (::fstat(file, &info) != 0 || ::pread(file, &header, sizeof(header), 0) != sizeof(header))
+		{
+			::close(file);
+			throw std::runtime_error("Файл " + std::string{path} + " не является двоичным файлом гармоник.");
+		}
+		try
+		{
+			_degree = verify_header(header, static_cast<size_t>(info.st_size), degree, path);
+		}
+		catch (...)
+		{
+			::close(file);
+			throw;
+		}
+		_length = sizeof(harmonics_header) + harmonics_count(_degree) * sizeof(potential_harmonic);
+		void *view = ::mmap(nullptr, _length, PROT_READ, MAP_SHARED, file, 0);
+		::close(file);
+		if (view == MAP_FAILED)
+		{
+			throw std::runtime_error("Не удалось отобразить в память файл " + std::string{path});
+		}
+		_view = view;
+	}
+
+	void mapped_harmonics::close() noexcept
+	{
+		if (_view)
+		{
+			::munmap(_view, _length);
+		}
+		_view = nullptr;
+	}
+#endif
+
+	mapped_harmonics::mapped_harmonics(mapped_harmonics &&other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	mapped_harmonics &mapped_harmonics::operator=(mapped_harmonics &&other) noexcept
+	{
+		std::swap(_handle, other._handle);
+		std::swap(_view, other._view);
+		std::swap(_length, other._length);
+		std::swap(_degree, other._degree);
+		return *this;
+	}
+
+	mapped_harmonics::~mapped_harmonics()
+	{
+		close();
+	}
+
+	potential_harmonic const *mapped_harmonics::data() const
+	{
+		return reinterpret_cast<potential_harmonic const *>(static_cast<char const *>(_view) + sizeof(harmonics_header));
+	}
+
+	bool is_binary_harmonics(std::string_view path)
+	{
+		std::ifstream fin{std::string{path}, std::ios_base::binary};
+		char magic[sizeof(harmonics_magic)]{};
+		fin.read(magic, sizeof(magic));
+		return fin && std::memcmp(magic, harmonics_magic, sizeof(magic)) == 0;
+	}
+
+	/**
+	 * @brief Чтение гармоник из текстового файла до заданной степени
+	 */
+	std::vector<potential_harmonic> read_text_harmonics(std::string_view path, size_t degree)
+	{
+		std::ifstream fin{std::string{path}};
+		if (!fin.is_open())
+		{
+			throw std::runtime_error("Не удалось открыть файл " + std::string{path});
+		}
+		std::vector<potential_harmonic> data;
+		data.reserve(harmonics_count(degree));
+		potential_harmonic h;
+		while (data.size() < harmonics_count(degree) && fin >> h.cos >> h.sin)
+		{
+			data.push_back(h);
+		}
+		// отбрасываются гармоники неполной старшей степени
+		data.resize(data.empty() ? 0 : harmonics_count(harmonics_degree(data.size())));
+		return data;
+	}
+
+	void load_harmonics(std::string_view path, size_t degree)
+	{
+		degree = std::min(degree, egm::count);
+		std::vector<potential_harmonic> data;
+		if (is_binary_harmonics(path))
+		{
+			mapped_harmonics mapped{path, degree};
+			data.assign(mapped.data(), mapped.data() + mapped.size());
+		}
+		else
+		{
+			data = read_text_harmonics(path, degree);
+		}
+		egm::harmonics.swap(data);
+	}
+
+	gravity_handle load_model(std::string name, std::string_view path, size_t degree)
+	{
+		if (is_binary_harmonics(path))
+		{
+			auto mapped = std::make_shared<mapped_harmonics const>(path, degree);
+			auto data = mapped->data();
+			auto mapped_degree = mapped->degree();
+			return std::make_shared<gravity_model const>(std::move(name), std::move(mapped), data, mapped_degree);
+		}
+		return std::make_shared<gravity_model const>(std::move(name), read_text_harmonics(path, degree));
+	}
+
+	gravity_handle gravity_registry::load(std::string const &name, std::string_view path, size_t degree)
+	{
+		// загрузка выполняется вне блокировки, чтобы не задерживать обращения к другим моделям
+		auto model = load_model(name, path, degree);
+		insert(model);
+		return model;
+	}
+
+	void gravity_registry::insert(gravity_handle model)
+	{
+		if (!model)
+		{
+			throw std::runtime_error("Не задана модель гравитационного поля.");
+		}
+		std::lock_guard<std::mutex> lock{_sync};
+		auto name = model->name();
+		_models[name] = std::move(model);
+	}
+
+	gravity_handle gravity_registry::get(std::string_view name) const
+	{
+		std::lock_guard<std::mutex> lock{_sync};
+		auto iter = _models.find(name);
+		if (iter == _models.end())
+		{
+			throw std::runtime_error("Модель гравитационного поля " + std::string{name} + " не загружена.");
+		}
+		return iter->second;
+	}
+
+	bool gravity_registry::contains(std::string_view name) const
+	{
+		std::lock_guard<std::mutex> lock{_sync};
+		return _models.find(name) != _models.end();
+	}
+
+	void gravity_registry::remove(std::string_view name)
+	{
+		std::lock_guard<std::mutex> lock{_sync};
+		auto iter = _models.find(name);
+		if (iter != _models.end())
+		{
+			_models.erase(iter);
+		}
+	}
+
+	gravity_registry &gravity_registry::global()
+	{
+		static gravity_registry registry;
+		return registry;
+	}
+}
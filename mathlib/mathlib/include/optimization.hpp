@@ -1,5 +1,6 @@
 #pragma once
 #include <maths.hpp>
+#include <vector>
 
 namespace math
 {
@@ -11,6 +12,15 @@ namespace math
     {
         virtual ~measurer() = default;
         virtual vector get_residuals(vector const &v) const = 0;
+        /**
+         * @brief Невязки для нескольких векторов параметров.
+         * По умолчанию векторы обрабатываются независимо и параллельно,
+         * реализация может вычислять их совместно (например, интегрируя все траектории за один проход).
+         *
+         * @param vs векторы параметров
+         * @return невязки для каждого вектора параметров
+         */
+        virtual std::vector<vector> get_batch_residuals(std::vector<vector> const &vs) const;
     };
     /**
      * @brief Интерфейс для предостваления вариаций параметров
@@ -96,6 +96,17 @@ namespace math
         }
     }
 
+    std::vector<vector> measurer::get_batch_residuals(std::vector<vector> const &vs) const
+    {
+        std::vector<vector> out(vs.size());
+        if (!vs.empty())
+        {
+            parallel_compute({}, vs.size(), [this, &vs, &out](std::size_t i)
+                             { out[i] = get_residuals(vs[i]); });
+        }
+        return out;
+    }
+
     /**
      * @brief Для формирования СЛАУ
      *
@@ -120,21 +131,14 @@ namespace math
         void operator()(vector const &v, matrix &mx, vector &rv) const
         {
 
-            std::vector<vector> vectors(_dv.size() + 1);
-            auto compute_func = [this, &vectors, &rv, &v](std::size_t i)
+            // векторы с вариациями параметров и исходный вектор (последний)
+            std::vector<vector> params(_dv.size() + 1, v);
+            for (std::size_t i{}; i < _dv.size(); ++i)
             {
-                if (i < _dv.size())
-                {
-                    auto p{v};
-                    p[i] += _dv[i];
-                    vectors[i] = _meas.get_residuals(p);
-                }
-                else
-                {
-                    rv = _meas.get_residuals(v);
-                }
-            };
-            parallel_compute({}, _dv.size() + 1, compute_func);
+                params[i][i] += _dv[i];
+            }
+            auto vectors = _meas.get_batch_residuals(params);
+            rv = std::move(vectors.back());
             if (mx.rows() != _dv.size() || mx.columns() != rv.size())
             {
                 mx = matrix(_dv.size(), rv.size());
@@ -2,26 +2,111 @@
 
 #include <maths.hpp>
 #include <times.hpp>
+#include <memory>
+#include <span>
 
 namespace math
 {
     vec6 operator*(vec6 const &left, time_t right);
     vec<42> operator*(vec<42> const &left, time_t right);
+    vec<24> operator*(vec<24> const &left, time_t right);
 }
 
 #include <integration.hpp>
+#include <encke.hpp>
+#include <chebyshev.hpp>
+#include <variational.hpp>
+#include <statistics.hpp>
+
+class gpt_field;
 
 using forecast = math::integrator<math::vec6, time_t, time_t>;
 
 /**
- * @brief Интегрирование по базовой модели движения центра масс
+ * @brief Интегрирование по базовой модели движения центра масс.
+ * Статистика интегрирования и вычисления правой части доступна в поле _stats прогноза.
  *
  * @param mp начальные параметры движения
  * @param tk конечное время
+ * @param field кэш ускорения геопотенциала, общий для прогнозов (см. motion_model::field)
  * @return forecast
  */
-forecast make_forecast(const math::vec6 &v, time_type tn, time_type tk, double s);
+forecast make_forecast(const math::vec6 &v, time_type tn, time_type tk, double s, std::shared_ptr<gpt_field const> field = nullptr);
+
+using inertial_forecast = math::gauss_jackson<math::vec6, time_t, time_t>;
+
+/**
+ * @brief Интегрирование методом Гаусса-Джексона в АСК по базовой модели движения центра масс.
+ * Статистика интегрирования и вычисления правой части доступна в поле _stats прогноза.
+ *
+ * @param v начальный вектор в ГСК
+ * @return прогноз в АСК
+ */
+inertial_forecast make_inertial_forecast(const math::vec6 &v, time_type tn, time_type tk, double s);
+
+using encke_forecast = encke_integrator<time_t, time_t>;
+
+/**
+ * @brief Интегрирование по методу Энке в АСК по базовой модели движения центра масс.
+ * Интегрируется только отклонение от кеплеровой орбиты, поэтому шаг 1 мин даёт на сутках погрешность 0.2-0.5 м
+ * (как у make_forecast с шагом 30 с) при вдвое меньшем кол-ве вычислений правой части.
+ * С шагом 2 мин погрешность возрастает до 15-35 м, с шагом 4 мин - до километров.
+ * Статистика интегрирования и вычисления правой части доступна в поле _stats прогноза.
+ *
+ * @param v начальный вектор в ГСК
+ * @param step шаг интегрирования отклонения
+ * @return прогноз в АСК
+ */
+encke_forecast make_encke_forecast(const math::vec6 &v, time_type tn, time_type tk, double s,
+                                   std::chrono::milliseconds step = std::chrono::seconds{60});
 
-using forecast_var = math::integrator<math::vec<55>, time_t, time_t>;
+using ephemeris = math::chebyshev_ephemeris<math::vec6, time_t>;
 
-forecast_var make_forecast(math::vec<55> const &v, time_type tn, time_type tk, double s);
+/**
+ * @brief Сжатие прогноза в кусочные разложения по полиномам Чебышёва (хранятся только коэффициенты разложений положений,
+ * скорости вычисляются дифференцированием). Для недели НОО объём в 10-17 раз меньше, чем у векторов и моментов узлов прогноза
+ * (допустимая погрешность 0.1-1 м).
+ *
+ * @param f прогноз
+ * @param tolerance допустимая погрешность положения [м] и скорости [м/с]
+ * @return эфемериды на промежутке прогноза
+ */
+ephemeris make_ephemeris(forecast const &f, double tolerance = 0.1);
+
+template <std::size_t P>
+using forecast_var = math::integrator<typename math::variational<P>::vector, time_t, time_t>;
+
+/**
+ * @brief Интегрирование с матрицей чувствительности по P параметрам (math::variational)
+ *
+ * @tparam P кол-во параметров: 6 - начальный вектор, 7 - также коэффициент давления излучения
+ * @param v начальный вектор с матрицей чувствительности (см. math::variational::initial)
+ */
+template <std::size_t P>
+forecast_var<P> make_variational_forecast(typename math::variational<P>::vector const &v, time_type tn, time_type tk, double s);
+
+/**
+ * @brief Интегрирование с матрицей чувствительности с вычислением векторов только на упорядоченные моменты
+ * (узлы интегрирования не сохраняются)
+ *
+ * @param times моменты в пределах [tn, tk]
+ * @param out векторы (по одному на каждый момент)
+ * @param stats статистика, в которую добавляются вычисления (потокобезопасно)
+ */
+template <std::size_t P>
+void make_variational_forecast(typename math::variational<P>::vector const &v, time_type tn, time_type tk, double s,
+                               std::span<time_t const> times, std::span<typename math::variational<P>::vector> out,
+                               math::statistics *stats = nullptr);
+
+/**
+ * @brief Совместное интегрирование нескольких траекторий (векторы упакованы по компонентам, см. motion_batch)
+ * с вычислением векторов только на упорядоченные моменты
+ *
+ * @param v упакованные начальные векторы
+ * @param times моменты в пределах [tn, tk]
+ * @param out упакованные векторы (по одному на каждый момент)
+ * @param stats статистика, в которую добавляются вычисления (потокобезопасно)
+ * @param field кэш ускорения геопотенциала, общий для прогнозов (см. motion_model::field)
+ */
+void make_forecast(math::vec<24> const &v, time_type tn, time_type tk, double s, std::span<time_t const> times, std::span<math::vec<24>> out,
+                   math::statistics *stats = nullptr, std::shared_ptr<gpt_field const> field = nullptr);
\ No newline at end of file
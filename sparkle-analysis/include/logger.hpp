@@ -4,6 +4,7 @@
 #include <residuals_provider.hpp>
 
 #include <optimization.hpp>
+#include <statistics.hpp>
 
 #include <ostream>
 #include <vector>
@@ -22,6 +23,11 @@ public:
     
     std::vector<residual_point> get_last_iteration_residuals() const override;
 
+    /**
+     * @brief Статистика прогнозов решения (выводится в протокол при BALLISTIC_STATISTICS)
+     */
+    math::statistics stats;
+
 private:
     measuring_interval _interval;
     std::vector<math::iteration> _iterations;
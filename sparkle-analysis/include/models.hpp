@@ -1,23 +1,97 @@
 #pragma once
-#include <ball.hpp>
+#include <gptfixed.hpp>
+#include <gptfield.hpp>
+#include <lockstep.hpp>
 #include <maths.hpp>
+#include <statistics.hpp>
+#include <variational.hpp>
+#include <memory>
 
 using time_t = int64_t;
 using vec42 = math::vec<42>;
-using vec55 = math::vec<55>;
+
+/**
+ * @brief Степень разложения геопотенциала в модели движения
+ *
+ */
+constexpr size_t gpt_degree{16};
+
+using motion_gpt = geopotential_fixed<gpt_degree>;
+
+/**
+ * @brief Кол-во траекторий, интегрируемых совместно (по размеру пакета геопотенциала).
+ * Больше траекторий разбиваются на группы, которые интегрируются параллельно.
+ *
+ */
+constexpr size_t batch_size{math::simd::dpack::size};
+
+using motion_batch = math::lockstep<6, batch_size>;
+using vec24 = motion_batch::batch;
 
 class motion_model
 {
-    geopotential _gpt;
+    motion_gpt _gpt;
     double _s;
 
     void verify_height(double const v[3], time_t t);
 
 public:
     math::interval<double> heights{1e5, 1e8};
+    /**
+     * @brief Время вычисления слагаемых правой части (собирается при BALLISTIC_STATISTICS)
+     */
+    math::statistics stats;
+    /**
+     * @brief Кэш ускорения геопотенциала, общий для прогнозов (необязателен).
+     * Если задан, заменяет геопотенциал модели в правых частях без вариаций: точность определяется степенью
+     * и погрешностью кэша, вне слоя кэш вычисляет ускорение по гармоникам. Вариации вычисляются по геопотенциалу модели.
+     */
+    std::shared_ptr<gpt_field const> field;
 
 public:
-    motion_model(size_t harmonics, double s);
+    explicit motion_model(double s);
     math::vec6 operator()(const math::vec6 &v, time_t t);
-    vec55 operator()(vec55 const &v, time_t t);
-};
\ No newline at end of file
+    /**
+     * @brief Правая часть уравнений движения для batch_size траекторий, упакованных по компонентам (motion_batch).
+     * Звёздное время и положения Солнца и Луны вычисляются один раз для всех траекторий,
+     * ускорения геопотенциала - пакетами точек.
+     *
+     * @param v упакованные векторы в ГСК
+     * @param t время в мс
+     */
+    vec24 operator()(vec24 const &v, time_t t);
+    /**
+     * @brief Правая часть уравнений движения в АСК.
+     * Силы вычисляются в ГСК и поворачиваются в АСК, ускорения от вращения ГСК отсутствуют,
+     * поэтому ускорение зависит только от положения.
+     *
+     * @param v вектор в АСК
+     * @param t время в мс
+     */
+    math::vec6 inertial(const math::vec6 &v, time_t t);
+    /**
+     * @brief Правая часть уравнений движения с матрицей чувствительности (math::variational).
+     * Параметр модели 6 (при P > 6) - коэффициент давления излучения.
+     *
+     * @tparam P кол-во параметров (6 или 7)
+     * @param v вектор в ГСК с матрицей чувствительности
+     * @param t время в мс
+     */
+    template <std::size_t P>
+    typename math::variational<P>::vector variations(typename math::variational<P>::vector const &v, time_t t);
+    /**
+     * @brief Возмущающее ускорение в АСК (ускорение правой части inertial без центрального поля) для метода Энке.
+     *
+     * @param v вектор в АСК
+     * @param t время в мс
+     */
+    math::vec3 perturbation(const math::vec6 &v, time_t t);
+};
+
+/**
+ * @brief Звёздное время с учётом долей секунды
+ *
+ * @param t время в мс
+ * @return звёздное время в рад
+ */
+double precise_sidereal_time(time_t t);
\ No newline at end of file
@@ -2,8 +2,18 @@
 #include <interval.hpp>
 
 #include <optimization.hpp>
+#include <statistics.hpp>
+#include <memory>
 
+class gpt_field;
 
-void run_optimization(measuring_interval const &inter, orbit_data &d, math::iterations_saver &saver, std::size_t iter_count);
+/**
+ * @brief Уточнение параметров движения по измерениям
+ *
+ * @param stats статистика, в которую добавляются вычисления всех прогнозов решения
+ * @param field кэш ускорения геопотенциала, общий для всех прогнозов решения (см. motion_model::field)
+ */
+void run_optimization(measuring_interval const &inter, orbit_data &d, math::iterations_saver &saver, std::size_t iter_count, math::statistics *stats = nullptr,
+                      std::shared_ptr<gpt_field const> field = nullptr);
 
-void run_optimization_s(measuring_interval const &inter, orbit_data &d, math::iterations_saver &saver, std::size_t iter_count);
\ No newline at end of file
+void run_optimization_s(measuring_interval const &inter, orbit_data &d, math::iterations_saver &saver, std::size_t iter_count, math::statistics *stats = nullptr);
\ No newline at end of file
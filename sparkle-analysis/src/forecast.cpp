@@ -1,5 +1,7 @@
 #include <forecast.hpp>
 #include <models.hpp>
+#include <transform.hpp>
+#include <ball.hpp>
 
 auto to_milliseconds(time_type const &t)
 {
@@ -18,30 +20,130 @@ namespace math
         return left * to_double(right);
     }
 
-    vec<55> operator*(vec<55> const &left, time_t right)
+    vec<42> operator*(vec<42> const &left, time_t right)
     {
         return left * to_double(right);
     }
-}
 
-constexpr size_t harmonics{16};
+    vec<24> operator*(vec<24> const &left, time_t right)
+    {
+        return left * to_double(right);
+    }
+}
 
-forecast make_forecast(const math::vec6 &v, time_type tn, time_type tk, double s)
+forecast make_forecast(const math::vec6 &v, time_type tn, time_type tk, double s, std::shared_ptr<gpt_field const> field)
 {
-    motion_model model{harmonics, s};
-    return forecast(v,
-                    to_milliseconds(tn),
-                    to_milliseconds(tk),
-                    model,
-                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::seconds{30}).count());
+    motion_model model{s};
+    model.field = std::move(field);
+    forecast f(v,
+               to_milliseconds(tn),
+               to_milliseconds(tk),
+               model,
+               std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::seconds{30}).count());
+    f._stats += model.stats;
+    return f;
 }
 
-forecast_var make_forecast(math::vec<55> const &v, time_type tn, time_type tk, double s)
+inertial_forecast make_inertial_forecast(const math::vec6 &v, time_type tn, time_type tk, double s)
 {
-    motion_model model{harmonics, s};
-    return forecast_var(v,
-                        to_milliseconds(tn),
+    motion_model model{s};
+    auto t = to_milliseconds(tn);
+    math::vec6 a;
+    transform<abs_cs, ort_cs, grw_cs, ort_cs>::backward(v.data(), v.data() + 3, precise_sidereal_time(t), egm::angv, a.data(), a.data() + 3);
+    inertial_forecast f(a,
+                        t,
                         to_milliseconds(tk),
-                        model,
+                        [&model](math::vec6 const &v, time_t t)
+                        { return model.inertial(v, t); },
                         std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::seconds{30}).count());
+    f._stats += model.stats;
+    return f;
+}
+
+encke_forecast make_encke_forecast(const math::vec6 &v, time_type tn, time_type tk, double s, std::chrono::milliseconds step)
+{
+    motion_model model{s};
+    auto t = to_milliseconds(tn);
+    math::vec6 a;
+    transform<abs_cs, ort_cs, grw_cs, ort_cs>::backward(v.data(), v.data() + 3, precise_sidereal_time(t), egm::angv, a.data(), a.data() + 3);
+    encke_forecast f(a,
+                     t,
+                     to_milliseconds(tk),
+                     [&model](math::vec6 const &v, time_t t)
+                     { return model.perturbation(v, t); },
+                     step.count(),
+                     1e-3);
+    f._stats += model.stats;
+    return f;
+}
+
+ephemeris make_ephemeris(forecast const &f, double tolerance)
+{
+    return ephemeris([&f](time_t t)
+                     { return f.point(t); },
+                     f._points.front().t,
+                     f._points.back().t,
+                     tolerance,
+                     1e-3); // время в мс, скорость в м/с
+}
+
+template <std::size_t P>
+forecast_var<P> make_variational_forecast(typename math::variational<P>::vector const &v, time_type tn, time_type tk, double s)
+{
+    motion_model model{s};
+    forecast_var<P> f(v,
+                      to_milliseconds(tn),
+                      to_milliseconds(tk),
+                      [&model](typename math::variational<P>::vector const &v, time_t t)
+                      { return model.variations<P>(v, t); },
+                      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::seconds{30}).count());
+    f._stats += model.stats;
+    return f;
+}
+
+template <std::size_t P>
+void make_variational_forecast(typename math::variational<P>::vector const &v, time_type tn, time_type tk, double s,
+                               std::span<time_t const> times, std::span<typename math::variational<P>::vector> out,
+                               math::statistics *stats)
+{
+    motion_model model{s};
+    forecast_var<P>::stream(v,
+                            to_milliseconds(tn),
+                            to_milliseconds(tk),
+                            [&model](typename math::variational<P>::vector const &v, time_t t)
+                            { return model.variations<P>(v, t); },
+                            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::seconds{30}).count(),
+                            times,
+                            out,
+                            &model.stats);
+    if (stats)
+    {
+        stats->accumulate(model.stats);
+    }
+}
+
+template forecast_var<6> make_variational_forecast<6>(math::variational<6>::vector const &, time_type, time_type, double);
+template forecast_var<7> make_variational_forecast<7>(math::variational<7>::vector const &, time_type, time_type, double);
+template void make_variational_forecast<6>(math::variational<6>::vector const &, time_type, time_type, double,
+                                           std::span<time_t const>, std::span<math::variational<6>::vector>, math::statistics *);
+template void make_variational_forecast<7>(math::variational<7>::vector const &, time_type, time_type, double,
+                                           std::span<time_t const>, std::span<math::variational<7>::vector>, math::statistics *);
+
+void make_forecast(math::vec<24> const &v, time_type tn, time_type tk, double s, std::span<time_t const> times, std::span<math::vec<24>> out,
+                   math::statistics *stats, std::shared_ptr<gpt_field const> field)
+{
+    motion_model model{s};
+    model.field = std::move(field);
+    math::integrator<vec24, time_t, time_t>::stream(v,
+                                                    to_milliseconds(tn),
+                                                    to_milliseconds(tk),
+                                                    model,
+                                                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::seconds{30}).count(),
+                                                    times,
+                                                    out,
+                                                    &model.stats);
+    if (stats)
+    {
+        stats->accumulate(model.stats);
+    }
 }
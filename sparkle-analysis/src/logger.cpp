@@ -109,6 +109,14 @@ void optimization_logger::print(std::ostream &os) const
     {
         os << iter << '\n';
     }
+    if constexpr (math::statistics_enabled)
+    {
+        os << "\nСтатистика прогнозов: " << stats.calls << " вычислений правой части, " << stats.steps << " шагов, "
+           << stats.queries << " запросов векторов.\n";
+        os << "Время вычисления ускорений [мс]: геопотенциал " << stats.time(math::force_term::geopotential) * 1e-6
+           << ", Солнце и Луна " << stats.time(math::force_term::bodies) * 1e-6
+           << ", давление излучения " << stats.time(math::force_term::radiation) * 1e-6 << '\n';
+    }
     os << "\n\nОкончание записи протокола вычислений. " << std::chrono::system_clock::now();
 }
 
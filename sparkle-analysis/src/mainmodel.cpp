@@ -3,8 +3,8 @@
 #include <mainmodel.hpp>
 #include <motion.hpp>
 
-#include <ball.hpp>
-#include <fileutils.hpp>
+#include <gptstore.hpp>
+#include <models.hpp>
 #include <maths.hpp>
 #include <observation_utils.hpp>
 
@@ -52,7 +52,7 @@ class ballistic_computer {
         }
         // для сохранения итераций
         auto saver = std::make_unique<optimization_logger>(iter_count, inter);
-        run_optimization(inter, tle, *saver, iter_count);
+        run_optimization(inter, tle, *saver, iter_count, &saver->stats);
         return saver;
     }
 
@@ -228,13 +228,8 @@ computational_model::computational_model()
 
 computational_model::~computational_model() = default;
 
-std::istream &operator>>(std::istream &is, potential_harmonic &p) {
-    return is >> p.cos >> p.sin;
-}
-
 void computational_model::read_gpt(std::string const &filepath) {
-    auto fin = open_infile(filepath);
-    egm::read_harmonics(std::istream_iterator<potential_harmonic>{fin}, {});
+    egm::load_harmonics(filepath, gpt_degree);
 }
 
 void computational_model::read_tle(std::string const &filepath) {
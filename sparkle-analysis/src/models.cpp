@@ -82,10 +82,30 @@ auto rotforce(double const v[6])
     return a;
 }
 
-auto gptforce(double const in[3], geopotential &gpt)
+/**
+ * @brief Производные ускорения от вращения ГСК по положению и по скорости
+ */
+auto diffrotforce()
+{
+    double constexpr w = egm::angv;
+    math::mat3x3 dr, dv;
+    dr[0][0] = dr[1][1] = w * w;
+    dv[0][1] = 2 * w;
+    dv[1][0] = -2 * w;
+    return std::make_pair(dr, dv);
+}
+
+auto gptforce(double const in[3], motion_gpt const &gpt, gpt_field const *field)
 {
     math::vec3 out;
-    gpt.diffbyxyz(in, out.data());
+    if (field)
+    {
+        field->diffbyxyz(in, out.data());
+    }
+    else
+    {
+        gpt.diffbyxyz(in, out.data());
+    }
     return out;
 }
 
@@ -105,7 +125,7 @@ auto diffgptforce(double const xyz[3])
     return a;
 }
 
-motion_model::motion_model(size_t harmonics, double s) : _gpt{harmonics}, _s{s}
+motion_model::motion_model(double s) : _s{s}
 {
 }
 
@@ -126,13 +146,13 @@ math::vec6 motion_model::operator()(const math::vec6 &v, time_t t)
     //  перевод в секунды
     t /= 1000;
     double st = sidereal_time(t);
-    sun s{t, st};
-    moon m{t, st};
+    sun s = math::timed(stats, math::force_term::bodies, [&] { return sun{t, st}; });
+    moon m = math::timed(stats, math::force_term::bodies, [&] { return moon{t, st}; });
     auto rotac = rotforce(v.data());
-    auto gptac = gptforce(v.data(), _gpt);
-    auto solac = s.gptforce(v.data());
-    auto lunac = m.gptforce(v.data());
-    auto preac = s.lightforce(_s);
+    auto gptac = math::timed(stats, math::force_term::geopotential, [&] { return gptforce(v.data(), _gpt, field.get()); });
+    auto solac = math::timed(stats, math::force_term::bodies, [&] { return s.gptforce(v.data()); });
+    auto lunac = math::timed(stats, math::force_term::bodies, [&] { return m.gptforce(v.data()); });
+    auto preac = math::timed(stats, math::force_term::radiation, [&] { return s.lightforce(_s); });
     return math::vec6{
         v[3],
         v[4],
@@ -143,55 +163,144 @@ math::vec6 motion_model::operator()(const math::vec6 &v, time_t t)
     };
 }
 
-vec55 motion_model::operator()(vec55 const &v, time_t t)
+template <std::size_t P>
+typename math::variational<P>::vector motion_model::variations(typename math::variational<P>::vector const &v, time_t t)
 {
+    using variations_t = math::variational<P>;
     verify_height(v.data(), t);
     t /= 1000;
     double st = sidereal_time(t);
-    sun s{t, st};
-    moon m{t, st};
-    double gptac[3], gptmx[3][3];
-    _gpt.ddiffbyxyz(v.data(), gptac, gptmx);
-    auto solac_ = s.gptforce(v.data());
-    auto lunac_ = m.gptforce(v.data());
-    auto [solac, solmx] = s.diffgptforce(v.data());
-    auto [lunac, lunmx] = m.diffgptforce(v.data());
-    auto ligac = s.lightforce(_s);
-    vec55 out;
-    constexpr std::size_t vdim{7};
-    for (std::size_t i{}; i <= vdim; ++i)
-    {
-        std::size_t index = (6 + (i - 1) * vdim) * std::size_t(i > 0);
-        // заносим производные координат
-        for (std::size_t j{}; j < 3; ++j)
-        {
-            out[index + j] = v[index + j + 3];
-        }
-        auto rotac = rotforce(v.data() + index);
-        // заносим ускорение от врашения ГСК
-        for (std::size_t j{}; j < 3; ++j)
+    sun s = math::timed(stats, math::force_term::bodies, [&] { return sun{t, st}; });
+    moon m = math::timed(stats, math::force_term::bodies, [&] { return moon{t, st}; });
+    gpt_values gpt;
+    math::timed(stats, math::force_term::geopotential, [&] { _gpt.evaluate<gpt_order::hessian>(v.data(), gpt); });
+    auto &gptac = gpt.du;
+    auto &gptmx = gpt.ddu;
+    auto [solac, solmx] = math::timed(stats, math::force_term::bodies, [&] { return s.diffgptforce(v.data()); });
+    auto [lunac, lunmx] = math::timed(stats, math::force_term::bodies, [&] { return m.diffgptforce(v.data()); });
+    auto ligac = math::timed(stats, math::force_term::radiation, [&] { return s.lightforce(_s); });
+    auto rotac = rotforce(v.data());
+    double ds[6]{v[3], v[4], v[5]};
+    for (std::size_t i{}; i < 3; ++i)
+    {
+        ds[3 + i] = rotac[i] + gptac[i] + solac[i] + lunac[i] + ligac[i];
+    }
+    // производные ускорения по положению (с центробежным) и по скорости (кориолисово)
+    auto [rotmx, cormx] = diffrotforce();
+    math::mat3x3 posmx;
+    for (std::size_t j{}; j < 3; ++j)
+    {
+        for (std::size_t k{}; k < 3; ++k)
         {
-            out[index + j + 3] = rotac[j];
+            posmx[j][k] = gptmx[j][k] + solmx[j][k] + lunmx[j][k] + rotmx[j][k];
         }
     }
-    // заносим ускорения геопотенциала
+    auto out = variations_t::derivative(v, ds, posmx, cormx);
+    if constexpr (P > 6)
+    {
+        // ускорение от давления излучения линейно по коэффициенту
+        auto preac = math::timed(stats, math::force_term::radiation, [&] { return s.lightforce(1); });
+        variations_t::add_parameter(out, 0, preac.data());
+    }
+    return out;
+}
+
+template math::variational<6>::vector motion_model::variations<6>(math::variational<6>::vector const &, time_t);
+template math::variational<7>::vector motion_model::variations<7>(math::variational<7>::vector const &, time_t);
+
+vec24 motion_model::operator()(vec24 const &v, time_t t)
+{
+    constexpr std::size_t k{batch_size};
+    double const *xyz[6];
+    for (std::size_t i{}; i < 6; ++i)
+    {
+        xyz[i] = motion_batch::component(v, i);
+    }
+    for (std::size_t i{}; i < k; ++i)
+    {
+        double p[3]{xyz[0][i], xyz[1][i], xyz[2][i]};
+        verify_height(p, t);
+    }
+    t /= 1000;
+    double st = sidereal_time(t);
+    sun s = math::timed(stats, math::force_term::bodies, [&] { return sun{t, st}; });
+    moon m = math::timed(stats, math::force_term::bodies, [&] { return moon{t, st}; });
+    vec24 out;
+    // производные координат
+    std::copy(xyz[3], xyz[3] + 3 * k, out.data());
+    double *ac[3];
     for (std::size_t i{}; i < 3; ++i)
     {
-        out[3 + i] += gptac[i] + solac[i] + lunac[i] + ligac[i];
+        ac[i] = motion_batch::component(out, 3 + i);
     }
-    // заносим ускорения от вариаций геопотенциала
-    for (std::size_t i{}; i < vdim; ++i)
+    math::timed(stats, math::force_term::geopotential, [&]
+                {
+                    if (!field)
+                    {
+                        _gpt.diffbyxyz(k, xyz[0], xyz[1], xyz[2], ac[0], ac[1], ac[2]);
+                        return;
+                    }
+                    // кэш вычисляет ускорения по точкам
+                    for (std::size_t i{}; i < k; ++i)
+                    {
+                        double p[3]{xyz[0][i], xyz[1][i], xyz[2][i]}, a[3];
+                        field->diffbyxyz(p, a);
+                        ac[0][i] = a[0];
+                        ac[1][i] = a[1];
+                        ac[2][i] = a[2];
+                    }
+                });
+    auto preac = math::timed(stats, math::force_term::radiation, [&] { return s.lightforce(_s); });
+    for (std::size_t i{}; i < k; ++i)
     {
-        std::size_t index{ 6 + i * vdim };
-        auto preac = s.lightforce(v[index + 6]);
+        double p[6];
+        for (std::size_t j{}; j < 6; ++j)
+        {
+            p[j] = xyz[j][i];
+        }
+        auto rotac = rotforce(p);
+        auto solac = math::timed(stats, math::force_term::bodies, [&] { return s.gptforce(p); });
+        auto lunac = math::timed(stats, math::force_term::bodies, [&] { return m.gptforce(p); });
         for (std::size_t j{}; j < 3; ++j)
         {
-            for (std::size_t k{}; k < 3; ++k)
-            {
-                out[index + 3 + j] += (gptmx[j][k] + solmx[j][k] + lunmx[j][k]) * v[index + k];
-            }
-            out[index + 3 + j] += preac[j];
+            ac[j][i] += rotac[j] + solac[j] + lunac[j] + preac[j];
         }
     }
     return out;
-}
\ No newline at end of file
+}
+
+math::vec6 motion_model::inertial(const math::vec6 &v, time_t t)
+{
+    double st = precise_sidereal_time(t);
+    math::vec3 xyz;
+    transform<abs_cs, ort_cs, grw_cs, ort_cs>::forward(v.data(), st, xyz.data());
+    verify_height(xyz.data(), t);
+    t /= 1000;
+    sun s = math::timed(stats, math::force_term::bodies, [&] { return sun{t, st}; });
+    moon m = math::timed(stats, math::force_term::bodies, [&] { return moon{t, st}; });
+    auto gptac = math::timed(stats, math::force_term::geopotential, [&] { return gptforce(xyz.data(), _gpt, field.get()); });
+    auto solac = math::timed(stats, math::force_term::bodies, [&] { return s.gptforce(xyz.data()); });
+    auto lunac = math::timed(stats, math::force_term::bodies, [&] { return m.gptforce(xyz.data()); });
+    auto preac = math::timed(stats, math::force_term::radiation, [&] { return s.lightforce(_s); });
+    math::vec3 grwac, absac;
+    for (std::size_t i{}; i < 3; ++i)
+    {
+        grwac[i] = gptac[i] + solac[i] + lunac[i] + preac[i];
+    }
+    transform<abs_cs, ort_cs, grw_cs, ort_cs>::backward(grwac.data(), st, absac.data());
+    return math::vec6{v[3], v[4], v[5], absac[0], absac[1], absac[2]};
+}
+
+math::vec3 motion_model::perturbation(const math::vec6 &v, time_t t)
+{
+    auto ac = inertial(v, t);
+    double r = std::sqrt(math::sqr(v[0]) + math::sqr(v[1]) + math::sqr(v[2]));
+    double mult = egm::mu / (r * r * r);
+    return math::vec3{ac[3] + v[0] * mult, ac[4] + v[1] * mult, ac[5] + v[2] * mult};
+}
+
+double precise_sidereal_time(time_t t)
+{
+    // за секунду ГСК поворачивается на 73 мкрад, что на орбите составляет сотни метров
+    return sidereal_time(t / 1000) + egm::angv * (t % 1000) * 1e-3;
+}
@@ -1,9 +1,12 @@
 #include <motion.hpp>
 
 #include <forecast.hpp>
+#include <models.hpp>
 #include <transform.hpp>
 #include <ball.hpp>
 #include <optimization.hpp>
+#include <parallel.hpp>
+#include <thread>
 
 constexpr std::size_t _res_size{2};
 
@@ -32,12 +35,73 @@ class model_measurer : public math::measurer
 {
     measuring_interval _inter;
     time_type _t;
+    /**
+     * @brief Статистика по всем прогнозам (невязки могут вычисляться параллельно)
+     */
+    mutable math::statistics _stats;
+    /**
+     * @brief Кэш ускорения геопотенциала, общий для всех прогнозов решения (необязателен)
+     */
+    std::shared_ptr<gpt_field const> _field;
 
 public:
-    model_measurer(measuring_interval const &inter, time_type t) : _inter{inter}, _t{t} {}
+    model_measurer(measuring_interval const &inter, time_type t, std::shared_ptr<gpt_field const> field = nullptr)
+        : _inter{inter}, _t{t}, _field{std::move(field)} {}
+    math::statistics const &stats() const { return _stats; }
     math::vector get_residuals(math::vector const &v) const override
     {
         auto f = _make_forecast(v);
+        auto rv = _residuals([&f](std::size_t, time_t ms)
+                             { return f.point(ms); });
+        _stats.accumulate(f._stats);
+        return rv;
+    }
+    /**
+     * @brief Если ядер меньше, чем векторов, траектории интегрируются совместно группами по batch_size (motion_batch),
+     * а группы - параллельно: в группе звёздное время и положения Солнца и Луны вычисляются один раз на этап,
+     * а геопотенциал - пакетом точек. Иначе каждый вектор обрабатывается в своём потоке (так быстрее по времени).
+     */
+    std::vector<math::vector> get_batch_residuals(std::vector<math::vector> const &vs) const override
+    {
+        if (std::thread::hardware_concurrency() >= vs.size())
+        {
+            return math::measurer::get_batch_residuals(vs);
+        }
+        std::vector<time_t> times;
+        times.reserve(_inter.points_count());
+        for (auto it = _inter.begin(); it != _inter.end(); ++it)
+        {
+            times.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(it.measurement().t.time_since_epoch()).count());
+        }
+        std::vector<math::vector> out(vs.size());
+        std::size_t groups = (vs.size() + batch_size - 1) / batch_size;
+        par::parallel_for(std::size_t{}, groups, [this, &vs, &times, &out](std::size_t group)
+                          {
+                              std::size_t first = group * batch_size;
+                              std::vector<math::vec6> states(std::min(batch_size, vs.size() - first));
+                              for (std::size_t k{}; k < states.size(); ++k)
+                              {
+                                  std::memcpy(states[k].data(), vs[first + k].data(), sizeof(math::vec6));
+                              }
+                              std::vector<vec24> points(times.size());
+                              make_forecast(motion_batch::pack(states), _t, _inter.tk(), 0, times, points, &_stats, _field);
+                              for (std::size_t k{}; k < states.size(); ++k)
+                              {
+                                  out[first + k] = _residuals([&points, k](std::size_t i, time_t)
+                                                              { return motion_batch::unpack(points[i], k); });
+                              } });
+        return out;
+    }
+
+private:
+    /**
+     * @brief Невязки с измерениями
+     *
+     * @param point вектор в ГСК на момент измерения: point(номер измерения, время в мс)
+     */
+    template <typename F>
+    math::vector _residuals(F &&point) const
+    {
         math::vector rv(_inter.points_count() * 2);
         auto begin = _inter.begin();
         auto end = _inter.end();
@@ -45,7 +109,7 @@ public:
         {
             auto &meas = begin.measurement();
             auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(meas.t.time_since_epoch()).count();
-            auto p = f.point(ms);
+            auto p = point(i / 2, ms);
             double sph[3];
             transform<abs_cs, sph_cs, grw_cs, ort_cs>::backward(p.data(), sidereal_time(ms / 1000), sph);
             rv[i++] = meas.i - sph[1];
@@ -55,12 +119,11 @@ public:
         return rv;
     }
 
-private:
     forecast _make_forecast(math::vector const &in) const
     {
         math::vec6 v;
         std::memcpy(v.data(), in.data(), sizeof(v));
-        return make_forecast(v, _t, _inter.tk(), 0); // in[6]);
+        return make_forecast(v, _t, _inter.tk(), 0, _field); // in[6]);
     }
 };
 
@@ -98,23 +161,37 @@ void diffsphbyxyz(double const xyz[3], double df[3], double dl[3])
 class motion_residuals : public math::residuals_provider
 {
     using transform_t = transform<abs_cs, sph_cs, grw_cs, ort_cs>;
+    /**
+     * @brief Параметры: начальный вектор и коэффициент давления излучения
+     */
+    using variations = math::variational<7>;
     measuring_interval _inter;
     time_type _t;
+    mutable math::statistics _stats;
 
 public:
     motion_residuals(measuring_interval const &inter, time_type t) : _inter{inter}, _t{t} {}
+    math::statistics const &stats() const { return _stats; }
     void get_residuals_and_derivatives(math::vector const &v, math::vector &rv, math::matrix &mx) const override
     {
-        auto f = _make_forecast_var(v);
+        // векторы только на моменты измерений, без хранения всех узлов интегрирования
+        std::vector<time_t> times;
+        times.reserve(_inter.points_count());
+        for (auto it = _inter.begin(); it != _inter.end(); ++it)
+        {
+            times.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(it.measurement().t.time_since_epoch()).count());
+        }
+        std::vector<variations::vector> points(times.size());
+        _make_forecast_var(v, times, points);
         rv = math::vector(_inter.points_count() * 2);
-        mx = math::matrix(7, rv.size());
+        mx = math::matrix(variations::parameters(), rv.size());
         auto begin = _inter.begin();
         auto end = _inter.end();
         for (std::size_t i{}; begin != end; ++begin, i += 2)
         {
             auto &meas = begin.measurement();
-            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(meas.t.time_since_epoch()).count();
-            auto p = f.point(ms);
+            auto ms = times[i / 2];
+            auto &p = points[i / 2];
             double st = sidereal_time(ms / 1000);
             double sph[3];
             transform_t::backward(p.data(), st, sph);
@@ -124,13 +201,13 @@ public:
             // производные широты и долготы по декартовым координатам
             double df[3], dl[3];
             diffsphbyxyz(p.data(), df, dl);
-            for (std::size_t r{}; r < mx.rows(); ++r)
+            for (size_t j{}; j < 3; ++j)
             {
-                size_t index{6 + r * mx.rows()};
-                for (size_t j{}; j < 3; ++j)
+                auto row = variations::row(p, j);
+                for (std::size_t r{}; r < mx.rows(); ++r)
                 {
-                    mx[r][i + 0] += df[j] * p[index + j];
-                    mx[r][i + 1] += dl[j] * p[index + j];
+                    mx[r][i + 0] += df[j] * row[r];
+                    mx[r][i + 1] += dl[j] * row[r];
                 }
             }
         }
@@ -154,19 +231,14 @@ public:
             double da = meas.a - sph[2];
             rv[i + 1] = absmin(da, 2 * math::pi - da);
         }
+        _stats.accumulate(f._stats);
         return rv;
     }
 
 private:
-    forecast_var _make_forecast_var(math::vector const &in) const
+    void _make_forecast_var(math::vector const &in, std::span<time_t const> times, std::span<variations::vector> out) const
     {
-        math::vec<55> v;
-        std::memcpy(v.data(), in.data(), sizeof(double) * 6);
-        for (std::size_t i{}; i < 7; ++i)
-        {
-            v[6 + 8 * i] = 1;
-        }
-        return make_forecast(v, _t, _inter.tk(), in[6]);
+        make_variational_forecast<variations::parameters()>(variations::initial(in.data()), _t, _inter.tk(), in[6], times, out, &_stats);
     }
 
     forecast _make_forecast(math::vector const &in) const
@@ -177,17 +249,26 @@ private:
     }
 };
 
-void run_optimization(measuring_interval const &inter, orbit_data &data, math::iterations_saver &saver, std::size_t iter_count)
+void run_optimization(measuring_interval const &inter, orbit_data &data, math::iterations_saver &saver, std::size_t iter_count, math::statistics *stats,
+                      std::shared_ptr<gpt_field const> field)
 {
     math::vector v = make_vector(data, 6);
-    model_measurer meas{inter, data.t};
+    model_measurer meas{inter, data.t, std::move(field)};
     parameters_variator var;
     math::levmarq(v, meas, var, nullptr, &saver, 1e-5, iter_count);
+    if (stats)
+    {
+        *stats += meas.stats();
+    }
 }
 
-void run_optimization_s(measuring_interval const &inter, orbit_data &d, math::iterations_saver &saver, std::size_t iter_count)
+void run_optimization_s(measuring_interval const &inter, orbit_data &d, math::iterations_saver &saver, std::size_t iter_count, math::statistics *stats)
 {
     math::vector v = make_vector(d, 7);
     motion_residuals res{inter, d.t};
     math::levmarq(v, res, &saver, 1e-5, iter_count);
+    if (stats)
+    {
+        *stats += res.stats();
+    }
 }